@@ -0,0 +1,95 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : anim.h
+  * @brief          : Header for streaming ANIM frame reader
+  ******************************************************************************
+  * @attention
+  *
+  * ANIM layout (little endian, one blob per animation in a PACK):
+  *
+  *   0x00  "ANIM"                  magic
+  *   0x04  uint16  frame_count
+  *   0x06  uint32  table_offset    frame table, from the blob start
+  *   0x0A  uint32  data_size       bytes of frame data
+  *   0x0E  uint32  tail_size       zero filled area after the frame data
+  *   table frame_count x (uint32 offset, uint32 size), offsets from the
+  *         first byte after the table
+  *
+  * The frame table is kept in RAM. Frames are streamed into two buffers:
+  * ANIM_GetFrame hands out frame N and starts the DMA read of frame N+1
+  * into the other buffer, so by the time the caller asks for the next
+  * frame it is usually already in RAM.
+  *
+  * The flash handle is busy while a prefetch runs; call ANIM_Close before
+  * using the flash for anything else.
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#ifndef __ANIM_H
+#define __ANIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "w25q128.h"
+#include "pack.h"
+
+/* Format */
+#define ANIM_MAGIC                0x4D494E41  // "ANIM"
+#define ANIM_HEADER_SIZE          18
+#define ANIM_TABLE_ENTRY_SIZE     8
+
+/* Configuration */
+#ifndef ANIM_MAX_FRAMES
+#define ANIM_MAX_FRAMES           64
+#endif
+#ifndef ANIM_FRAME_BUFFER_SIZE
+#define ANIM_FRAME_BUFFER_SIZE    4096  // Largest frame accepted, x2 in RAM
+#endif
+
+/* Status */
+typedef enum {
+    ANIM_OK        = 0x00,
+    ANIM_ERROR     = 0x01,            // Flash access failed or bad argument
+    ANIM_FORMAT    = 0x02,            // Not a valid (or too large) animation
+    ANIM_END       = 0x03             // Last frame already returned
+} ANIM_Status_t;
+
+/* Frame table entry */
+typedef struct {
+    uint32_t offset;                  // From data_address
+    uint32_t size;
+} ANIM_Frame_t;
+
+/* Player handle */
+typedef struct {
+    W25Q128_Handle_t *hflash;
+    uint32_t data_address;            // Flash address of frame 0 data
+    uint16_t frame_count;
+    uint16_t next_frame;              // Frame ANIM_GetFrame returns next
+    uint8_t loop;                     // Wrap to frame 0 after the last frame
+    uint8_t fill;                     // Buffer receiving next_frame
+    uint8_t pending;                  // DMA read into buffers[fill] started
+    uint8_t ready;                    // buffers[fill] holds (or receives) next_frame
+    ANIM_Frame_t frames[ANIM_MAX_FRAMES];
+    uint8_t buffers[2][ANIM_FRAME_BUFFER_SIZE];
+} ANIM_Handle_t;
+
+/* Function Prototypes */
+ANIM_Status_t ANIM_Open(ANIM_Handle_t *hanim, W25Q128_Handle_t *hflash, uint32_t address, uint32_t size);
+ANIM_Status_t ANIM_OpenByName(ANIM_Handle_t *hanim, PACK_Handle_t *hpack, const char *name);
+ANIM_Status_t ANIM_OpenByIndex(ANIM_Handle_t *hanim, PACK_Handle_t *hpack, uint16_t index);
+ANIM_Status_t ANIM_GetFrame(ANIM_Handle_t *hanim, const uint8_t **data, uint32_t *size);
+ANIM_Status_t ANIM_Seek(ANIM_Handle_t *hanim, uint16_t frame);
+void ANIM_SetLoop(ANIM_Handle_t *hanim, uint8_t loop);
+void ANIM_Close(ANIM_Handle_t *hanim);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ANIM_H */
@@ -0,0 +1,91 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : pack.h
+  * @brief          : Header for PACK asset container reader
+  ******************************************************************************
+  * @attention
+  *
+  * PACK layout (little endian, as written to tools/animations.bin):
+  *
+  *   0x00  "PACK"                  magic
+  *   0x04  uint16  count           number of directory entries
+  *   0x06  count x 40 bytes        entries: char name[32] (NUL padded),
+  *                                 uint32 offset, uint32 size
+  *
+  * Offsets are relative to the start of the pack. PACK_Open reads the
+  * directory once and keeps a hash table of (name hash, offset, size) in
+  * RAM, so PACK_Find costs a few probes and a single 32-byte flash read
+  * (to confirm the name of the entry the hash points at) whatever the
+  * number of assets. PACK_FindIndex looks assets up by directory position
+  * without touching flash. Names are not kept in RAM: two names with the
+  * same 32-bit hash are rejected at open time.
+  *
+  * Open the pack again after it has been rewritten on flash.
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#ifndef __PACK_H
+#define __PACK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "w25q128.h"
+
+/* Format */
+#define PACK_MAGIC                0x4B434150  // "PACK"
+#define PACK_HEADER_SIZE          6
+#define PACK_NAME_SIZE            32
+#define PACK_ENTRY_SIZE           40
+
+/* Configuration */
+#ifndef PACK_MAX_ENTRIES
+#define PACK_MAX_ENTRIES          64
+#endif
+#define PACK_TABLE_SIZE           128   // Power of two, >= 2 x PACK_MAX_ENTRIES
+
+#if PACK_TABLE_SIZE < 2 * PACK_MAX_ENTRIES || (PACK_TABLE_SIZE & (PACK_TABLE_SIZE - 1)) != 0
+#error "PACK_TABLE_SIZE must be a power of two of at least 2 x PACK_MAX_ENTRIES"
+#endif
+
+/* Status */
+typedef enum {
+    PACK_OK        = 0x00,
+    PACK_ERROR     = 0x01,            // Flash access failed
+    PACK_FORMAT    = 0x02,            // No valid pack at this address
+    PACK_FULL      = 0x03,            // More than PACK_MAX_ENTRIES entries
+    PACK_NOT_FOUND = 0x04
+} PACK_Status_t;
+
+/* Hash table slot, offset 0 = empty (no entry can start at offset 0) */
+typedef struct {
+    uint32_t hash;
+    uint32_t offset;
+    uint32_t size;
+    uint16_t entry;                   // Directory index, to check the name
+} PACK_Slot_t;
+
+/* Pack handle */
+typedef struct {
+    W25Q128_Handle_t *hflash;
+    uint32_t base;                    // Flash address of the pack
+    uint16_t count;
+    uint8_t max_probe;                // Longest probe sequence in the table
+    PACK_Slot_t table[PACK_TABLE_SIZE];
+    uint8_t order[PACK_MAX_ENTRIES];  // Directory index -> table slot
+} PACK_Handle_t;
+
+/* Function Prototypes */
+PACK_Status_t PACK_Open(PACK_Handle_t *hpack, W25Q128_Handle_t *hflash, uint32_t base);
+PACK_Status_t PACK_Find(PACK_Handle_t *hpack, const char *name, uint32_t *address, uint32_t *size);
+PACK_Status_t PACK_FindIndex(PACK_Handle_t *hpack, uint16_t index, uint32_t *address, uint32_t *size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PACK_H */
@@ -0,0 +1,85 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : profile.h
+  * @brief          : Header for DWT cycle-counter profiling
+  ******************************************************************************
+  * @attention
+  *
+  * Per-call cycle counts of the flash driver and bootloader hot paths, taken
+  * from the Cortex-M4 DWT cycle counter (one count per HCLK cycle; it wraps
+  * after 2^32 cycles, 42.9 s at 100MHz, so a chip erase can read short).
+  *
+  * Each profiling point keeps the number of calls, min, max, total and a
+  * log2 histogram: bucket 0 counts calls of 0 cycles, bucket b calls of
+  * 2^(b-1) to 2^b - 1 cycles, and the last bucket everything longer.
+  * BOOT_CMD_GET_STATS sends the table to the host.
+  *
+  * Off unless built with PROF_ENABLED=1: the PROF_START/PROF_STOP/PROF_MARK
+  * macros then expand to nothing and the points cost no code or time.
+  * Calls that leave a function through an early error return are not
+  * recorded.
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32f4xx_hal.h"
+
+/* Configuration */
+#ifndef PROF_ENABLED
+#define PROF_ENABLED              0
+#endif
+#define PROF_BUCKETS              32    // log2 buckets, covers the whole 32-bit range
+
+/* Profiling points */
+typedef enum {
+    PROF_FLASH_READ = 0,              // W25Q128_Read
+    PROF_FLASH_READ_ASYNC,            // W25Q128_ReadAsync until its completion/error callback
+    PROF_FLASH_WRITE_PAGE,            // W25Q128_WritePage, program included
+    PROF_FLASH_WAIT_SPIN,             // Status polling part of W25Q128_WaitForWriteEndTimeout
+    PROF_FLASH_ERASE_4KB,             // EraseStart until the erase is seen done,
+    PROF_FLASH_ERASE_32KB,            // one point per W25Q128_EraseType_t
+    PROF_FLASH_ERASE_64KB,            // (same order)
+    PROF_FLASH_ERASE_CHIP,
+    PROF_BOOT_CRC16,                  // BOOT_UpdateCRC16 (every CRC16 block)
+    PROF_POINT_COUNT
+} PROF_Point_t;
+
+/* Statistics of one point */
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t histogram[PROF_BUCKETS];
+} PROF_Stats_t;
+
+#if PROF_ENABLED
+#define PROF_START(var)           uint32_t var = DWT->CYCCNT
+#define PROF_STOP(point, var)     PROF_Record((point), DWT->CYCCNT - (var))
+#define PROF_MARK(var)            ((var) = DWT->CYCCNT)
+#else
+#define PROF_START(var)
+#define PROF_STOP(point, var)
+#define PROF_MARK(var)
+#endif
+
+/* Function Prototypes */
+void PROF_Init(void);
+void PROF_Reset(void);
+void PROF_Record(PROF_Point_t point, uint32_t cycles);
+const PROF_Stats_t *PROF_GetStats(PROF_Point_t point);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PROFILE_H */
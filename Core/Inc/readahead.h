@@ -0,0 +1,74 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : readahead.h
+  * @brief          : Header for sequential read-ahead on top of the W25Q128 driver
+  ******************************************************************************
+  * @attention
+  *
+  * Small reads each pay the command/address phase and a CS cycle. RA_Read
+  * keeps a ring of RA_SLOTS buffers of RA_CHUNK_SIZE bytes: once a read
+  * starts where the previous one ended, the following chunks are fetched
+  * ahead of time (W25Q128_ReadAsync, so on DMA when the SPI has it) and
+  * later small reads are copied from RAM.
+  *
+  * Random reads go straight to flash and do not disturb the ring. While a
+  * prefetch is running the flash handle is busy; call RA_Invalidate before
+  * using the flash directly (and after writing or erasing it).
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#ifndef __READAHEAD_H
+#define __READAHEAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "w25q128.h"
+
+/* Configuration */
+#ifndef RA_SLOTS
+#define RA_SLOTS                  2     // Ring length, 2 = double buffering
+#endif
+#ifndef RA_CHUNK_SIZE
+#define RA_CHUNK_SIZE             1024  // Bytes fetched per prefetch
+#endif
+
+#if RA_SLOTS < 2
+#error "RA_SLOTS must be at least 2"
+#endif
+
+#define RA_NO_SLOT                0xFF
+
+/* Ring slot */
+typedef struct {
+    uint32_t address;                 // Flash address of data[0]
+    uint32_t length;                  // Valid bytes, 0 = empty
+    uint8_t data[RA_CHUNK_SIZE];
+} RA_Slot_t;
+
+/* Read-ahead handle */
+typedef struct {
+    W25Q128_Handle_t *hflash;
+    RA_Slot_t slots[RA_SLOTS];
+    uint8_t head;                     // Slot holding the highest addresses
+    uint8_t prefetch_slot;            // Slot being filled, RA_NO_SLOT if none
+    uint8_t streaming;                // Sequential access detected
+    uint32_t next_address;            // Where a sequential read would start
+    uint32_t hits;                    // Bytes copied from the ring
+    uint32_t misses;                  // Blocking flash reads
+} RA_Handle_t;
+
+/* Function Prototypes */
+void RA_Init(RA_Handle_t *hra, W25Q128_Handle_t *hflash);
+W25Q128_Status_t RA_Read(RA_Handle_t *hra, uint32_t address, uint8_t *buffer, uint32_t length);
+W25Q128_Status_t RA_Invalidate(RA_Handle_t *hra);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __READAHEAD_H */
@@ -0,0 +1,68 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : sector_cache.h
+  * @brief          : Header for write-back 4KB sector cache
+  ******************************************************************************
+  * @attention
+  *
+  * Byte granular read/write on top of the W25Q128 driver. Writes land in a
+  * RAM copy of their 4KB sector (SCACHE_LINES lines, least recently used
+  * is evicted) and reach the flash on SCACHE_Flush or eviction, so many
+  * small updates of one sector cost a single erase + program.
+  *
+  * A flush only erases when it has to: if every changed bit goes from 1 to
+  * 0 the new data is programmed over the old without an erase.
+  *
+  * Data written through the cache is only safe on flash after SCACHE_Flush.
+  * Do not mix cached writes with direct W25Q128_Write/Erase calls on the
+  * same sectors without flushing first.
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#ifndef __SECTOR_CACHE_H
+#define __SECTOR_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "w25q128.h"
+
+/* Configuration */
+#ifndef SCACHE_LINES
+#define SCACHE_LINES              2     // 4KB of RAM per line
+#endif
+
+/* Cache line */
+typedef struct {
+    uint32_t sector;                  // Sector start address
+    uint8_t valid;
+    uint8_t dirty;
+    uint32_t last_use;                // LRU stamp
+    uint8_t data[W25Q128_SECTOR_SIZE];
+} SCACHE_Line_t;
+
+/* Cache handle */
+typedef struct {
+    W25Q128_Handle_t *hflash;
+    SCACHE_Line_t lines[SCACHE_LINES];
+    uint32_t use_counter;
+    uint32_t erase_count;             // Sector erases done by flushes
+    uint32_t flush_count;             // Dirty lines written back
+} SCACHE_Handle_t;
+
+/* Function Prototypes */
+void SCACHE_Init(SCACHE_Handle_t *hcache, W25Q128_Handle_t *hflash);
+W25Q128_Status_t SCACHE_Read(SCACHE_Handle_t *hcache, uint32_t address, uint8_t *buffer, uint32_t length);
+W25Q128_Status_t SCACHE_Write(SCACHE_Handle_t *hcache, uint32_t address, const uint8_t *buffer, uint32_t length);
+W25Q128_Status_t SCACHE_Flush(SCACHE_Handle_t *hcache);
+void SCACHE_Invalidate(SCACHE_Handle_t *hcache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SECTOR_CACHE_H */
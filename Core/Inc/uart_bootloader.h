@@ -17,6 +17,70 @@
   * 6. PC sends: CHECKSUM (2 bytes, CRC16)
   * 7. STM32 responds: ACK (0x79) or NACK (0x1F)
   *
+  * Pipelined writes (BOOT_PIPELINED_WRITE):
+  * A write packet is ACKed as soon as its CRC checks out and is programmed
+  * while the next packet is already streaming into the UART DMA ring buffer.
+  * A programming failure is reported by NACKing the next write, or by
+  * BOOT_CMD_SYNC which the host sends after the last packet.
+  * Every NACK of BOOT_CMD_WRITE and BOOT_CMD_SYNC is followed by
+  * FAILED_ADDRESS (4 bytes, little endian): the address of the packet whose
+  * programming failed, which is not necessarily the packet just sent, or
+  * BOOT_NO_ADDRESS when the packet just sent was rejected unprogrammed.
+  *
+  * Windowed writes (BOOT_CMD_WRITE_WINDOW):
+  * PC sends: START_MARKER, COMMAND, SEQ (2 bytes), DATA_LENGTH (4 bytes),
+  *           ADDRESS (4 bytes), DATA, CRC16 over SEQ..DATA (2 bytes)
+  * STM32 responds: ACK or NACK followed by the next expected SEQ (2 bytes).
+  * The host may keep up to BOOT_WINDOW_SIZE packets in flight; they queue
+  * in the RX ring. Packets are accepted strictly in order (go-back-N): on
+  * NACK the host resends from the returned SEQ. A valid packet with SEQ 0
+  * starts a new stream.
+  *
+  * Baud rate switch (BOOT_CMD_SET_BAUD):
+  * PC sends BAUDRATE (4 bytes); STM32 ACKs at the current rate (or NACKs an
+  * unreachable rate) and switches. The PC switches too and sends a probe
+  * (START_MARKER + BOOT_CMD_SET_BAUD) which the STM32 ACKs at the new rate.
+  * Without a probe within BOOT_BAUD_PROBE_MS the STM32 returns to the old
+  * rate. After BOOT_BAUD_IDLE_MS without traffic it falls back to the
+  * power-on rate (and CRC16 integrity) so a new host session can always
+  * connect.
+  *
+  * Integrity mode (BOOT_CMD_SET_INTEGRITY):
+  * PC sends MODE (1 byte, BOOT_Integrity_t); STM32 ACKs, or NACKs a mode
+  * it cannot do. In BOOT_INTEGRITY_CRC32 mode the CRC16 of BOOT_CMD_WRITE,
+  * BOOT_CMD_WRITE_WINDOW and BOOT_CMD_READ packets is replaced by a CRC32
+  * (4 bytes, little endian) from the STM32 CRC unit: CRC-32/MPEG-2 (poly
+  * 0x04C11DB7, init 0xFFFFFFFF, no reflection, no final XOR) over the
+  * covered bytes taken as little endian 32-bit words, the last partial
+  * word padded with zero bytes. Sessions start in BOOT_INTEGRITY_CRC16.
+  *
+  * Verify (BOOT_CMD_VERIFY):
+  * PC sends DATA_LENGTH (4 bytes) and ADDRESS (4 bytes); STM32 reads the
+  * range from flash and responds ACK + CRC32 (4 bytes, little endian, same
+  * as zlib.crc32) or NACK.
+  *
+  * Sector hashes (BOOT_CMD_HASH_SECTORS):
+  * PC sends DATA_LENGTH (4 bytes) and ADDRESS (4 bytes); STM32 responds ACK
+  * followed by one CRC32 (4 bytes) per 4KB sector touched by the range, each
+  * covering only the part of the range inside that sector. At most
+  * BOOT_HASH_MAX_SECTORS sectors per request.
+  *
+  * Background erase (BOOT_CMD_ERASE_CHIP, BOOT_CMD_ERASE_RANGE):
+  * For BOOT_CMD_ERASE_RANGE the PC sends DATA_LENGTH (4 bytes) and ADDRESS
+  * (4 bytes); the range is widened to 4KB sectors. The STM32 validates the request, starts the erase as a job and ACKs
+  * right away. The job advances while BOOT_Process waits for the next
+  * command. BOOT_CMD_JOB_STATUS responds ACK followed by STATE (1 byte,
+  * BOOT_JobState_t), COMMAND (1 byte), ELAPSED_MS (4 bytes), DONE (4 bytes)
+  * and TOTAL (4 bytes, both in bytes of flash). Any other flash command
+  * first waits for the job to finish.
+  *
+  * Profiling statistics (BOOT_CMD_GET_STATS):
+  * PC sends FLAGS (1 byte, BOOT_STATS_CLEAR resets the statistics after
+  * the dump). STM32 responds ACK, POINTS (1 byte, 0 when built without
+  * PROF_ENABLED), BUCKETS (1 byte) and HCLK_HZ (4 bytes), then per
+  * PROF_Point_t: COUNT, MIN, MAX (4 bytes each), TOTAL (8 bytes) and
+  * BUCKETS histogram counts (4 bytes each), all in cycles, little endian.
+  *
   ******************************************************************************
   */
 /* USER CODE END Header */
@@ -30,6 +94,7 @@ extern "C" {
 
 #include "stm32f4xx_hal.h"
 #include "w25q128.h"
+#include "profile.h"
 
 /* Protocol markers and commands */
 #define BOOT_START_MARKER1        0xAA
@@ -44,11 +109,40 @@ extern "C" {
 #define BOOT_CMD_ERASE_CHIP       0x04  // Erase entire chip
 #define BOOT_CMD_GET_INFO         0x05  // Get flash info
 #define BOOT_CMD_VERIFY           0x06  // Verify written data
+#define BOOT_CMD_SYNC             0x07  // Report status of pipelined writes
+#define BOOT_CMD_WRITE_WINDOW     0x08  // Sequenced write for sliding-window uploads
+#define BOOT_CMD_SET_BAUD         0x09  // Switch UART baud rate
+#define BOOT_CMD_ERASE_RANGE      0x0A  // Erase range with 64KB/32KB/4KB mix
+#define BOOT_CMD_HASH_SECTORS     0x0B  // Per-sector CRC32 list for a range
+#define BOOT_CMD_JOB_STATUS       0x0C  // Progress of a background erase
+#define BOOT_CMD_GET_STATS        0x0D  // Dump profiling histograms
+#define BOOT_CMD_SET_INTEGRITY    0x0E  // Select the packet checksum
 
 /* Configuration */
 #define BOOT_MAX_DATA_SIZE        4096  // Maximum data size per packet
 #define BOOT_TIMEOUT_MS           5000  // 5 seconds timeout
 #define BOOT_BUFFER_SIZE          256   // UART buffer size
+#define BOOT_WINDOW_SIZE          3     // Max windowed write packets in flight
+#define BOOT_WINDOW_HEADER_SIZE   10    // SEQ + DATA_LENGTH + ADDRESS
+#define BOOT_RX_RING_SIZE         16384 // UART DMA receive ring (holds BOOT_WINDOW_SIZE full packets)
+#define BOOT_PIPELINED_WRITE      1     // ACK writes before programming (see above)
+#define BOOT_WRITE_FLAGS          W25Q128_WRITE_SKIP_BLANK  // W25Q128_WriteEx flags for uploads
+#define BOOT_HASH_MAX_SECTORS     256   // Sectors per BOOT_CMD_HASH_SECTORS request (1MB)
+#define BOOT_BAUD_PROBE_MS        1000  // Wait for the host probe after a baud switch
+#define BOOT_BAUD_IDLE_MS         10000 // Idle time before returning to the power-on rate and CRC16
+#define BOOT_BAUD_MAX_ERROR       20    // Max baud rate error in 1/1000
+#ifndef BOOT_CRC16_SLICE_BY_4
+#define BOOT_CRC16_SLICE_BY_4     1     // 2KB of CRC16 tables instead of 512 bytes, 4 bytes per step
+#endif
+
+/* FAILED_ADDRESS of a write NACK that rejects the current packet */
+#define BOOT_NO_ADDRESS           0xFFFFFFFF
+
+/* CRC16 start value (BOOT_UpdateCRC16) */
+#define BOOT_CRC16_INIT           0xFFFF
+
+/* BOOT_CMD_GET_STATS flags */
+#define BOOT_STATS_CLEAR          0x01  // Reset the statistics after sending them
 
 /* Status codes */
 typedef enum {
@@ -58,21 +152,54 @@ typedef enum {
     BOOT_CRC_ERR  = 0x03
 } BOOT_Status_t;
 
+/* Packet checksums (BOOT_CMD_SET_INTEGRITY) */
+typedef enum {
+    BOOT_INTEGRITY_CRC16  = 0x00,     // CRC-16/CCITT in software
+    BOOT_INTEGRITY_CRC32  = 0x01      // CRC-32/MPEG-2 on the CRC unit
+} BOOT_Integrity_t;
+
+/* Background job states (reported by BOOT_CMD_JOB_STATUS) */
+typedef enum {
+    BOOT_JOB_IDLE    = 0x00,
+    BOOT_JOB_BUSY    = 0x01,
+    BOOT_JOB_DONE    = 0x02,
+    BOOT_JOB_FAILED  = 0x03
+} BOOT_JobState_t;
+
 /* Bootloader handle */
 typedef struct {
     UART_HandleTypeDef *huart;
     W25Q128_Handle_t *hflash;
+    CRC_HandleTypeDef *hcrc;              // CRC unit, NULL = CRC16 only
+    BOOT_Integrity_t integrity;           // Checksum of write/read packets
     uint8_t rx_buffer[BOOT_BUFFER_SIZE];
+    uint8_t rx_ring[BOOT_RX_RING_SIZE];   // Circular DMA target
+    uint32_t rx_tail;                     // Next byte to consume from rx_ring
+    uint8_t rx_dma;                       // 1 if USART RX runs on circular DMA
+    uint8_t write_error;                  // Deferred error from a pipelined write
+    uint32_t write_error_address;         // Address of the packet that failed
+    uint16_t window_next_seq;             // Next expected windowed write SEQ
+    uint32_t default_baudrate;            // Power-on baud rate
+    BOOT_JobState_t job_state;            // Background erase job
+    uint8_t job_command;                  // Command that started the job
+    uint32_t job_address;                 // Erased up to here
+    uint32_t job_step;                    // Size of the erase in progress
+    uint32_t job_start;                   // Start of the job range
+    uint32_t job_end;                     // End of the job range
+    uint32_t job_start_tick;
+    uint32_t job_elapsed_ms;              // Final duration once the job ended
     uint32_t total_bytes_written;
     uint32_t total_bytes_read;
 } BOOT_Handle_t;
 
 /* Function prototypes */
-void BOOT_Init(BOOT_Handle_t *hboot, UART_HandleTypeDef *huart, W25Q128_Handle_t *hflash);
+void BOOT_Init(BOOT_Handle_t *hboot, UART_HandleTypeDef *huart, W25Q128_Handle_t *hflash, CRC_HandleTypeDef *hcrc);
 void BOOT_Process(BOOT_Handle_t *hboot);
 BOOT_Status_t BOOT_SendResponse(BOOT_Handle_t *hboot, uint8_t response);
 BOOT_Status_t BOOT_SendData(BOOT_Handle_t *hboot, uint8_t *data, uint32_t length);
 uint16_t BOOT_CalculateCRC16(uint8_t *data, uint32_t length);
+uint16_t BOOT_UpdateCRC16(uint16_t crc, const uint8_t *data, uint32_t length);
+uint32_t BOOT_CalculateCRC32(uint32_t crc, uint8_t *data, uint32_t length);
 
 #ifdef __cplusplus
 }
@@ -9,8 +9,9 @@
   * W25Q128JVSQ 16MB SPI NOR Flash Driver
   * - Supports read, write, erase operations
   * - Sector size: 4KB
-  * - Block size: 64KB  
+  * - Block size: 32KB / 64KB
   * - Total capacity: 16MB (128Mbit)
+  * - Non-blocking reads via SPI RX/TX DMA (W25Q128_ReadAsync)
   *
   ******************************************************************************
   */
@@ -24,6 +25,7 @@ extern "C" {
 #endif
 
 #include "stm32f4xx_hal.h"
+#include "profile.h"
 
 /* W25Q128 Commands */
 #define W25Q128_CMD_WRITE_ENABLE           0x06
@@ -47,21 +49,84 @@ extern "C" {
 #define W25Q128_CMD_MANUFACTURER_DEVICE_ID 0x90
 #define W25Q128_CMD_JEDEC_ID               0x9F
 #define W25Q128_CMD_READ_UNIQUE_ID         0x4B
+#define W25Q128_CMD_READ_SFDP              0x5A
 
-/* W25Q128 Parameters */
+/* 4-byte address command set (parts above 16MB) */
+#define W25Q128_CMD_READ_DATA_4B           0x13
+#define W25Q128_CMD_FAST_READ_4B           0x0C
+#define W25Q128_CMD_PAGE_PROGRAM_4B        0x12
+#define W25Q128_CMD_SECTOR_ERASE_4KB_4B    0x21
+#define W25Q128_CMD_BLOCK_ERASE_64KB_4B    0xDC
+
+/* W25Q128 Parameters (defaults until W25Q128_Discover has run; the 4KB
+   sector and 256 byte page are used for every supported part) */
 #define W25Q128_PAGE_SIZE                  256
 #define W25Q128_SECTOR_SIZE                4096
 #define W25Q128_BLOCK_SIZE_32KB            (32 * 1024)
 #define W25Q128_BLOCK_SIZE_64KB            (64 * 1024)
 #define W25Q128_TOTAL_SIZE                 (16 * 1024 * 1024)  // 16MB
+#define W25Q128_3BYTE_ADDRESS_LIMIT        (16 * 1024 * 1024)  // Above this: 4-byte commands
+#define W25Q128_MAX_COMMAND_SIZE           6                   // Opcode + 4 address + 1 dummy
+
+/* SFDP (JESD216) */
+#define W25Q128_SFDP_SIGNATURE             0x50444653  // "SFDP"
+#define W25Q128_SFDP_BFPT_ID               0x00        // Basic Flash Parameter Table
+#define W25Q128_SFDP_BFPT_DWORDS           11          // DWORDs used from the BFPT
 
 /* Status Register Bits */
 #define W25Q128_STATUS_BUSY                0x01
 #define W25Q128_STATUS_WEL                 0x02
+#define W25Q128_STATUS2_SUS                0x80  // Status Register 2: erase/program suspended
 
 /* Timeout */
 #define W25Q128_TIMEOUT_MS                 1000
 
+/* Typical busy times from the datasheet; waits stay off the bus this long
+   before polling (tPP is 0.4 ms, below the tick resolution) */
+#define W25Q128_TYPICAL_PAGE_PROGRAM_MS    0
+#define W25Q128_TYPICAL_SECTOR_ERASE_MS    45
+#define W25Q128_TYPICAL_BLOCK_ERASE_32KB_MS 120
+#define W25Q128_TYPICAL_BLOCK_ERASE_64KB_MS 150
+#define W25Q128_TYPICAL_CHIP_ERASE_MS      40000
+
+/* Maximum busy times from the datasheet (tPP, tSE, tBE1, tBE2, tCE) */
+#define W25Q128_TIMEOUT_PAGE_PROGRAM_MS    3
+#define W25Q128_TIMEOUT_SECTOR_ERASE_MS    400
+#define W25Q128_TIMEOUT_BLOCK_ERASE_32KB_MS 1600
+#define W25Q128_TIMEOUT_BLOCK_ERASE_64KB_MS 2000
+#define W25Q128_TIMEOUT_CHIP_ERASE_MS      200000
+
+/* W25Q128_WriteEx flags */
+#define W25Q128_WRITE_SKIP_BLANK           0x01  // Skip 0xFF pages, trim 0xFF page ends
+#define W25Q128_WRITE_SKIP_UNCHANGED       0x02  // Read back, skip pages already holding the data
+
+/* Minimum erase run time between a resume and the next suspend, so that
+   back-to-back reads cannot starve a running erase */
+#define W25Q128_SUSPEND_INTERVAL_MS        2
+
+/* SPI clock. The read limits are the datasheet fR (0x03) and FR (0x0B);
+   W25Q128_SetClock rounds down to a reachable prescaler, so on the
+   F411 (SPI1 max PCLK2/2 = 50MHz) both phases end up at 50MHz. */
+#define W25Q128_READ_DATA_MAX_HZ           50000000
+#define W25Q128_FAST_READ_MAX_HZ           133000000
+#define W25Q128_CMD_CLOCK_HZ               50000000   // Commands, status, page program
+#define W25Q128_READ_CLOCK_HZ              133000000  // Bulk reads
+
+/* Transport for command/address/status phases: 1 = SPI and GPIO registers
+   directly, 0 = HAL calls. Bulk data always uses the HAL. */
+#ifndef W25Q128_USE_LL_TRANSPORT
+#define W25Q128_USE_LL_TRANSPORT           1
+#endif
+
+/* Register transport: polling iterations per flag before giving up */
+#define W25Q128_LL_SPIN_LIMIT              10000
+
+/* Largest single SPI data transfer (DMA_SxNDTR and the HAL sizes are 16 bits) */
+#define W25Q128_DMA_MAX_TRANSFER           0xFFFF
+
+/* Handles W25Q128_FindHandle can route SPI callbacks to (one per chip) */
+#define W25Q128_MAX_HANDLES                8
+
 /* Return Status */
 typedef enum {
     W25Q128_OK       = 0x00,
@@ -70,26 +135,107 @@ typedef enum {
     W25Q128_TIMEOUT  = 0x03
 } W25Q128_Status_t;
 
+/* Erase granularity for W25Q128_EraseStart */
+typedef enum {
+    W25Q128_ERASE_SECTOR_4KB = 0x00,
+    W25Q128_ERASE_BLOCK_32KB = 0x01,
+    W25Q128_ERASE_BLOCK_64KB = 0x02,
+    W25Q128_ERASE_CHIP       = 0x03
+} W25Q128_EraseType_t;
+
+#define W25Q128_ERASE_TYPE_COUNT           4
+
+typedef struct W25Q128_Handle W25Q128_Handle_t;
+
+/* Asynchronous read completion callback (called from DMA interrupt context) */
+typedef void (*W25Q128_Callback_t)(W25Q128_Handle_t *hflash, W25Q128_Status_t status);
+
 /* W25Q128 Handle Structure */
-typedef struct {
+struct W25Q128_Handle {
     SPI_HandleTypeDef *hspi;
     GPIO_TypeDef *cs_port;
     uint16_t cs_pin;
-} W25Q128_Handle_t;
+
+    /* Geometry and commands, discovered from JEDEC ID and SFDP */
+    uint8_t jedec_id[3];
+    uint8_t sfdp_valid;
+    uint32_t capacity;                // Bytes
+    uint8_t address_bytes;            // 3, or 4 for parts above 16MB
+    uint8_t read_opcode;              // READ DATA or FAST READ
+    uint8_t program_opcode;
+    uint32_t cmd_prescaler;           // SPI_BAUDRATEPRESCALER_x for commands
+    uint32_t read_prescaler;          // SPI_BAUDRATEPRESCALER_x for bulk reads
+    uint8_t read_dummy;               // Dummy bytes after the address
+    uint8_t erase_opcode[W25Q128_ERASE_TYPE_COUNT];  // 0 = not supported
+    uint32_t erase_typ_ms[W25Q128_ERASE_TYPE_COUNT];
+    uint32_t erase_max_ms[W25Q128_ERASE_TYPE_COUNT];
+
+    /* Asynchronous (DMA) read state */
+    volatile uint8_t async_busy;
+    volatile W25Q128_Status_t async_status;
+    uint8_t *async_buffer;
+    uint32_t async_remaining;
+    W25Q128_Callback_t async_callback;
+    void *async_context;              // Free for the caller, passed back via the handle
+#if PROF_ENABLED
+    uint32_t async_start_cycles;      // DWT->CYCCNT at ReadAsync
+#endif
+
+    /* Page program started by W25Q128_ProgramStart, not yet seen finished */
+    volatile uint8_t program_active;
+
+    /* Background erase state. Reads of the sector/block being erased
+       while it is suspended return undefined data. */
+    volatile uint8_t erase_active;
+    volatile uint8_t erase_suspended;
+    W25Q128_EraseType_t erase_type;
+    uint32_t erase_start_tick;        // Shifted by the time spent suspended
+    uint32_t erase_suspend_tick;
+    uint32_t erase_resume_tick;
+    uint32_t erase_typical_ms;
+    uint32_t erase_timeout_ms;
+#if PROF_ENABLED
+    uint32_t erase_start_cycles;      // DWT->CYCCNT at EraseStart
+#endif
+};
 
 /* Function Prototypes */
 void W25Q128_Init(W25Q128_Handle_t *hflash, SPI_HandleTypeDef *hspi, GPIO_TypeDef *cs_port, uint16_t cs_pin);
+W25Q128_Status_t W25Q128_Discover(W25Q128_Handle_t *hflash);
+void W25Q128_SetClock(W25Q128_Handle_t *hflash, uint32_t cmd_hz, uint32_t read_hz);
+W25Q128_Status_t W25Q128_ReadSFDP(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint16_t length);
 W25Q128_Status_t W25Q128_ReadID(W25Q128_Handle_t *hflash, uint8_t *manufacturer_id, uint8_t *device_id);
 W25Q128_Status_t W25Q128_ReadJEDECID(W25Q128_Handle_t *hflash, uint8_t *jedec_id);
 W25Q128_Status_t W25Q128_WriteEnable(W25Q128_Handle_t *hflash);
 W25Q128_Status_t W25Q128_WriteDisable(W25Q128_Handle_t *hflash);
 W25Q128_Status_t W25Q128_WaitForWriteEnd(W25Q128_Handle_t *hflash);
+W25Q128_Status_t W25Q128_WaitForWriteEndTimeout(W25Q128_Handle_t *hflash, uint32_t typical_ms, uint32_t timeout_ms);
+void W25Q128_IdleHook(W25Q128_Handle_t *hflash);
 W25Q128_Status_t W25Q128_ReadStatusRegister(W25Q128_Handle_t *hflash, uint8_t *status);
+W25Q128_Status_t W25Q128_ReadStatusRegister2(W25Q128_Handle_t *hflash, uint8_t *status);
 W25Q128_Status_t W25Q128_Read(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length);
+W25Q128_Status_t W25Q128_ReadAsync(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length, W25Q128_Callback_t callback);
+W25Q128_Status_t W25Q128_ReadAsyncStatus(W25Q128_Handle_t *hflash);
+W25Q128_Status_t W25Q128_ReadAsyncWait(W25Q128_Handle_t *hflash, uint32_t timeout_ms);
+W25Q128_Handle_t *W25Q128_FindHandle(SPI_HandleTypeDef *hspi);
+void W25Q128_SPI_RxCpltCallback(W25Q128_Handle_t *hflash, SPI_HandleTypeDef *hspi);
+void W25Q128_SPI_ErrorCallback(W25Q128_Handle_t *hflash, SPI_HandleTypeDef *hspi);
+W25Q128_Status_t W25Q128_ProgramStart(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length);
+W25Q128_Status_t W25Q128_ProgramPoll(W25Q128_Handle_t *hflash);
+W25Q128_Status_t W25Q128_ProgramWait(W25Q128_Handle_t *hflash);
 W25Q128_Status_t W25Q128_WritePage(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length);
 W25Q128_Status_t W25Q128_Write(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length);
+W25Q128_Status_t W25Q128_WriteEx(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length, uint32_t flags);
+W25Q128_Status_t W25Q128_EraseStart(W25Q128_Handle_t *hflash, W25Q128_EraseType_t type, uint32_t address);
+W25Q128_Status_t W25Q128_ErasePoll(W25Q128_Handle_t *hflash);
+W25Q128_Status_t W25Q128_EraseWait(W25Q128_Handle_t *hflash);
+uint32_t W25Q128_ErasePlan(W25Q128_Handle_t *hflash, uint32_t address, uint32_t end_address, W25Q128_EraseType_t *type);
+W25Q128_Status_t W25Q128_EraseSuspend(W25Q128_Handle_t *hflash);
+W25Q128_Status_t W25Q128_EraseResume(W25Q128_Handle_t *hflash);
 W25Q128_Status_t W25Q128_EraseSector(W25Q128_Handle_t *hflash, uint32_t sector_address);
+W25Q128_Status_t W25Q128_EraseBlock32KB(W25Q128_Handle_t *hflash, uint32_t block_address);
 W25Q128_Status_t W25Q128_EraseBlock64KB(W25Q128_Handle_t *hflash, uint32_t block_address);
+W25Q128_Status_t W25Q128_EraseRange(W25Q128_Handle_t *hflash, uint32_t address, uint32_t length);
 W25Q128_Status_t W25Q128_EraseChip(W25Q128_Handle_t *hflash);
 W25Q128_Status_t W25Q128_PowerDown(W25Q128_Handle_t *hflash);
 W25Q128_Status_t W25Q128_WakeUp(W25Q128_Handle_t *hflash);
@@ -0,0 +1,56 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : w25q_array.h
+  * @brief          : Header for striped W25Q flash array
+  ******************************************************************************
+  * @attention
+  *
+  * Several W25Q parts on one SPI bus (one CS line each) seen as a single
+  * address space. The logical space is cut into stripes of stripe_size
+  * bytes that go to the chips in turn:
+  *
+  *   stripe n -> chip (n % count), physical address (n / count) * stripe_size
+  *
+  * Writes and erases keep every chip busy at once: while one chip is
+  * programming a page or erasing a block, the bus is used to start the next
+  * operation on another chip. Each chip is driven through its own
+  * W25Q128_Handle_t, initialised beforehand with W25Q128_Init.
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#ifndef __W25Q_ARRAY_H
+#define __W25Q_ARRAY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "w25q128.h"
+
+/* Configuration */
+#define W25Q_ARRAY_MAX_CHIPS          4
+#define W25Q_ARRAY_DEFAULT_STRIPE     W25Q128_SECTOR_SIZE  // Interleave unit
+
+/* Array handle */
+typedef struct {
+    W25Q128_Handle_t *chips[W25Q_ARRAY_MAX_CHIPS];
+    uint8_t count;
+    uint32_t stripe_size;             // Power of two, multiple of the sector size
+    uint32_t capacity;                // count * smallest chip capacity
+} W25Q_ARRAY_Handle_t;
+
+/* Function Prototypes */
+W25Q128_Status_t W25Q_ARRAY_Init(W25Q_ARRAY_Handle_t *harray, W25Q128_Handle_t **chips, uint8_t count, uint32_t stripe_size);
+W25Q128_Status_t W25Q_ARRAY_Read(W25Q_ARRAY_Handle_t *harray, uint32_t address, uint8_t *buffer, uint32_t length);
+W25Q128_Status_t W25Q_ARRAY_Write(W25Q_ARRAY_Handle_t *harray, uint32_t address, uint8_t *buffer, uint32_t length);
+W25Q128_Status_t W25Q_ARRAY_EraseRange(W25Q_ARRAY_Handle_t *harray, uint32_t address, uint32_t length);
+W25Q128_Status_t W25Q_ARRAY_EraseChip(W25Q_ARRAY_Handle_t *harray);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __W25Q_ARRAY_H */
@@ -0,0 +1,298 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : anim.c
+  * @brief          : Streaming ANIM frame reader Implementation
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#include "anim.h"
+
+/**
+  * @brief  Read a little endian 32-bit value
+  * @param  data: Pointer to 4 bytes
+  * @retval Value
+  */
+static uint32_t ANIM_ReadU32(const uint8_t *data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/**
+  * @brief  Start reading next_frame into the fill buffer
+  * @note   If the DMA read cannot be started, ANIM_GetFrame reads the frame
+  *         in blocking mode instead.
+  * @param  hanim: Pointer to player handle
+  * @retval None
+  */
+static void ANIM_Prefetch(ANIM_Handle_t *hanim)
+{
+    ANIM_Frame_t *frame = &hanim->frames[hanim->next_frame];
+    
+    hanim->ready = 0;
+    
+    if (frame->size == 0)
+    {
+        hanim->ready = 1;
+        return;
+    }
+    
+    if (W25Q128_ReadAsync(hanim->hflash, hanim->data_address + frame->offset,
+                          hanim->buffers[hanim->fill], frame->size, NULL) == W25Q128_OK)
+    {
+        hanim->pending = 1;
+        hanim->ready = 1;
+    }
+}
+
+/**
+  * @brief  Wait for the running prefetch, if any
+  * @param  hanim: Pointer to player handle
+  * @retval None
+  */
+static void ANIM_Wait(ANIM_Handle_t *hanim)
+{
+    if (!hanim->pending)
+    {
+        return;
+    }
+    
+    if (W25Q128_ReadAsyncWait(hanim->hflash, W25Q128_TIMEOUT_MS) != W25Q128_OK)
+    {
+        hanim->ready = 0;
+    }
+    hanim->pending = 0;
+}
+
+/**
+  * @brief  Open an animation and start fetching its first frame
+  * @param  hanim: Pointer to player handle
+  * @param  hflash: Initialised flash handle
+  * @param  address: Flash address of the ANIM blob
+  * @param  size: Size of the blob in bytes
+  * @retval ANIM_Status_t
+  */
+ANIM_Status_t ANIM_Open(ANIM_Handle_t *hanim, W25Q128_Handle_t *hflash, uint32_t address, uint32_t size)
+{
+    uint8_t header[ANIM_HEADER_SIZE];
+    uint8_t *table = (uint8_t *)hanim->frames;
+    uint32_t table_offset;
+    uint32_t table_end;
+    uint32_t data_size;
+    uint16_t i;
+    
+    hanim->hflash = hflash;
+    hanim->frame_count = 0;
+    hanim->next_frame = 0;
+    hanim->fill = 0;
+    hanim->pending = 0;
+    hanim->ready = 0;
+    hanim->loop = 1;
+    
+    if (size < ANIM_HEADER_SIZE)
+    {
+        return ANIM_FORMAT;
+    }
+    
+    if (W25Q128_Read(hflash, address, header, ANIM_HEADER_SIZE) != W25Q128_OK)
+    {
+        return ANIM_ERROR;
+    }
+    
+    if (ANIM_ReadU32(header) != ANIM_MAGIC)
+    {
+        return ANIM_FORMAT;
+    }
+    
+    hanim->frame_count = header[4] | (header[5] << 8);
+    table_offset = ANIM_ReadU32(&header[6]);
+    data_size = ANIM_ReadU32(&header[10]);
+    
+    if (hanim->frame_count == 0 || hanim->frame_count > ANIM_MAX_FRAMES ||
+        table_offset < ANIM_HEADER_SIZE || table_offset > size)
+    {
+        hanim->frame_count = 0;
+        return ANIM_FORMAT;
+    }
+    
+    table_end = table_offset + (uint32_t)hanim->frame_count * ANIM_TABLE_ENTRY_SIZE;
+    if (table_end > size || data_size > size - table_end)
+    {
+        hanim->frame_count = 0;
+        return ANIM_FORMAT;
+    }
+    
+    // The raw table lands in frames[] and is decoded in place
+    if (W25Q128_Read(hflash, address + table_offset, table,
+                     (uint32_t)hanim->frame_count * ANIM_TABLE_ENTRY_SIZE) != W25Q128_OK)
+    {
+        hanim->frame_count = 0;
+        return ANIM_ERROR;
+    }
+    
+    for (i = 0; i < hanim->frame_count; i++)
+    {
+        const uint8_t *entry = &table[i * ANIM_TABLE_ENTRY_SIZE];
+        uint32_t frame_offset = ANIM_ReadU32(entry);
+        uint32_t frame_size = ANIM_ReadU32(&entry[4]);
+        
+        if (frame_offset > data_size || frame_size > data_size - frame_offset ||
+            frame_size > ANIM_FRAME_BUFFER_SIZE)
+        {
+            hanim->frame_count = 0;
+            return ANIM_FORMAT;
+        }
+        
+        hanim->frames[i].offset = frame_offset;
+        hanim->frames[i].size = frame_size;
+    }
+    
+    hanim->data_address = address + table_end;
+    
+    ANIM_Prefetch(hanim);
+    
+    return ANIM_OK;
+}
+
+/**
+  * @brief  Open an animation of a pack by name
+  * @param  hanim: Pointer to player handle
+  * @param  hpack: Opened pack
+  * @param  name: Asset name
+  * @retval ANIM_Status_t
+  */
+ANIM_Status_t ANIM_OpenByName(ANIM_Handle_t *hanim, PACK_Handle_t *hpack, const char *name)
+{
+    uint32_t address;
+    uint32_t size;
+    
+    if (PACK_Find(hpack, name, &address, &size) != PACK_OK)
+    {
+        return ANIM_ERROR;
+    }
+    
+    return ANIM_Open(hanim, hpack->hflash, address, size);
+}
+
+/**
+  * @brief  Open an animation of a pack by directory index
+  * @param  hanim: Pointer to player handle
+  * @param  hpack: Opened pack
+  * @param  index: Directory index
+  * @retval ANIM_Status_t
+  */
+ANIM_Status_t ANIM_OpenByIndex(ANIM_Handle_t *hanim, PACK_Handle_t *hpack, uint16_t index)
+{
+    uint32_t address;
+    uint32_t size;
+    
+    if (PACK_FindIndex(hpack, index, &address, &size) != PACK_OK)
+    {
+        return ANIM_ERROR;
+    }
+    
+    return ANIM_Open(hanim, hpack->hflash, address, size);
+}
+
+/**
+  * @brief  Get the next frame and start prefetching the one after it
+  * @note   The returned data stays valid until the next ANIM_GetFrame,
+  *         ANIM_Seek or ANIM_Close call.
+  * @param  hanim: Pointer to player handle
+  * @param  data: Returns a pointer to the frame data
+  * @param  size: Returns the frame size in bytes
+  * @retval ANIM_OK, ANIM_END once the last frame has been returned (loop
+  *         off), or an error
+  */
+ANIM_Status_t ANIM_GetFrame(ANIM_Handle_t *hanim, const uint8_t **data, uint32_t *size)
+{
+    ANIM_Frame_t *frame;
+    
+    if (hanim->frame_count == 0)
+    {
+        return ANIM_ERROR;
+    }
+    
+    if (hanim->next_frame >= hanim->frame_count)
+    {
+        return ANIM_END;
+    }
+    
+    frame = &hanim->frames[hanim->next_frame];
+    
+    ANIM_Wait(hanim);
+    
+    // Prefetch could not run: read the frame now
+    if (!hanim->ready)
+    {
+        if (W25Q128_Read(hanim->hflash, hanim->data_address + frame->offset,
+                         hanim->buffers[hanim->fill], frame->size) != W25Q128_OK)
+        {
+            return ANIM_ERROR;
+        }
+    }
+    
+    *data = hanim->buffers[hanim->fill];
+    *size = frame->size;
+    
+    hanim->fill ^= 1;
+    hanim->next_frame++;
+    
+    if (hanim->next_frame == hanim->frame_count)
+    {
+        if (!hanim->loop)
+        {
+            hanim->ready = 0;
+            return ANIM_OK;
+        }
+        hanim->next_frame = 0;
+    }
+    
+    ANIM_Prefetch(hanim);
+    
+    return ANIM_OK;
+}
+
+/**
+  * @brief  Continue playback from a given frame
+  * @param  hanim: Pointer to player handle
+  * @param  frame: Frame index
+  * @retval ANIM_Status_t
+  */
+ANIM_Status_t ANIM_Seek(ANIM_Handle_t *hanim, uint16_t frame)
+{
+    if (frame >= hanim->frame_count)
+    {
+        return ANIM_ERROR;
+    }
+    
+    ANIM_Wait(hanim);
+    
+    hanim->next_frame = frame;
+    ANIM_Prefetch(hanim);
+    
+    return ANIM_OK;
+}
+
+/**
+  * @brief  Set whether playback wraps to frame 0 (on by default)
+  * @param  hanim: Pointer to player handle
+  * @param  loop: 1 to wrap, 0 to stop with ANIM_END
+  * @retval None
+  */
+void ANIM_SetLoop(ANIM_Handle_t *hanim, uint8_t loop)
+{
+    hanim->loop = loop;
+}
+
+/**
+  * @brief  Stop playback and release the flash
+  * @param  hanim: Pointer to player handle
+  * @retval None
+  */
+void ANIM_Close(ANIM_Handle_t *hanim)
+{
+    ANIM_Wait(hanim);
+    hanim->frame_count = 0;
+}
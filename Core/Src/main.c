@@ -22,10 +22,14 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "gpio.h"
+#include "dma.h"
 #include "spi.h"
 #include "usart.h"
+#include "crc.h"
 #include "w25q128.h"
 #include "uart_bootloader.h"
+#include "pack.h"
+#include "profile.h"
 #include <stdio.h>
 #include <string.h>
 /* USER CODE END Includes */
@@ -37,6 +41,7 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+#define PACK_FLASH_ADDRESS  0x00000000  // Where tools/animations.bin is uploaded
 
 /* USER CODE END PD */
 
@@ -50,6 +55,7 @@
 /* USER CODE BEGIN PV */
 W25Q128_Handle_t hflash;
 BOOT_Handle_t hboot;
+PACK_Handle_t hpack;
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -102,10 +108,15 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_SPI1_Init();
   MX_USART1_UART_Init();
+  MX_CRC_Init();
   /* USER CODE BEGIN 2 */
   
+  // Start the cycle counter (no-op unless built with PROF_ENABLED)
+  PROF_Init();
+  
   // Initialize W25Q128 Flash
   W25Q128_Init(&hflash, &hspi1, SPI1_NSS_GPIO_Port, SPI1_NSS_Pin);
   
@@ -128,8 +139,18 @@ int main(void)
     HAL_UART_Transmit(&huart1, (uint8_t*)msg, strlen(msg), 1000);
   }
   
+  // Index the asset pack once, later lookups stay in RAM
+  if (PACK_Open(&hpack, &hflash, PACK_FLASH_ADDRESS) == PACK_OK)
+  {
+    printf("PACK: %u assets\r\n", hpack.count);
+  }
+  else
+  {
+    printf("PACK: none at 0x%08lX\r\n", (unsigned long)PACK_FLASH_ADDRESS);
+  }
+  
   // Initialize UART Bootloader
-  BOOT_Init(&hboot, &huart1, &hflash);
+  BOOT_Init(&hboot, &huart1, &hflash, &hcrc);
   
   char ready_msg[] = "\r\nUART Bootloader Ready!\r\nWaiting for commands...\r\n";
   HAL_UART_Transmit(&huart1, (uint8_t*)ready_msg, strlen(ready_msg), 1000);
@@ -197,6 +218,36 @@ void SystemClock_Config(void)
 
 /* USER CODE BEGIN 4 */
 
+/**
+  * @brief  SPI receive complete callback, forwards DMA completion to the flash handle reading on hspi
+  * @param  hspi: SPI handle
+  * @retval None
+  */
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+  W25Q128_Handle_t *flash = W25Q128_FindHandle(hspi);
+
+  if (flash != NULL)
+  {
+    W25Q128_SPI_RxCpltCallback(flash, hspi);
+  }
+}
+
+/**
+  * @brief  SPI error callback, forwards DMA errors to the flash handle reading on hspi
+  * @param  hspi: SPI handle
+  * @retval None
+  */
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+  W25Q128_Handle_t *flash = W25Q128_FindHandle(hspi);
+
+  if (flash != NULL)
+  {
+    W25Q128_SPI_ErrorCallback(flash, hspi);
+  }
+}
+
 /* USER CODE END 4 */
 
 /**
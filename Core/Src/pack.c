@@ -0,0 +1,287 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : pack.c
+  * @brief          : PACK asset container reader Implementation
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#include "pack.h"
+#include <string.h>
+
+#define PACK_READ_ENTRIES         8     // Directory entries read per flash access
+
+/**
+  * @brief  FNV-1a hash of an asset name
+  * @param  name: Name, NUL terminated or PACK_NAME_SIZE bytes long
+  * @retval 32-bit hash
+  */
+static uint32_t PACK_Hash(const char *name)
+{
+    uint32_t hash = 0x811C9DC5;
+    uint8_t i;
+    
+    for (i = 0; i < PACK_NAME_SIZE && name[i] != '\0'; i++)
+    {
+        hash ^= (uint8_t)name[i];
+        hash *= 0x01000193;
+    }
+    
+    return hash;
+}
+
+/**
+  * @brief  Read a little endian 32-bit value
+  * @param  data: Pointer to 4 bytes
+  * @retval Value
+  */
+static uint32_t PACK_ReadU32(const uint8_t *data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+/**
+  * @brief  Add a directory entry to the hash table
+  * @param  hpack: Pointer to pack handle
+  * @param  hash: Name hash
+  * @param  offset: Asset offset in the pack
+  * @param  size: Asset size
+  * @param  entry: Directory index
+  * @param  slot: Returns the table slot used
+  * @retval PACK_Status_t
+  */
+static PACK_Status_t PACK_Insert(PACK_Handle_t *hpack, uint32_t hash, uint32_t offset, uint32_t size, uint16_t entry, uint8_t *slot)
+{
+    uint32_t index = hash & (PACK_TABLE_SIZE - 1);
+    uint8_t probe = 0;
+    
+    while (hpack->table[index].offset != 0)
+    {
+        // Same name twice, or two names sharing a hash: lookups would be ambiguous
+        if (hpack->table[index].hash == hash)
+        {
+            return PACK_FORMAT;
+        }
+        
+        index = (index + 1) & (PACK_TABLE_SIZE - 1);
+        probe++;
+    }
+    
+    hpack->table[index].hash = hash;
+    hpack->table[index].offset = offset;
+    hpack->table[index].size = size;
+    hpack->table[index].entry = entry;
+    *slot = (uint8_t)index;
+    
+    if (probe > hpack->max_probe)
+    {
+        hpack->max_probe = probe;
+    }
+    
+    return PACK_OK;
+}
+
+/**
+  * @brief  Load the directory of a pack into RAM
+  * @param  hpack: Pointer to pack handle
+  * @param  hflash: Initialised flash handle
+  * @param  base: Flash address of the pack
+  * @retval PACK_Status_t
+  */
+PACK_Status_t PACK_Open(PACK_Handle_t *hpack, W25Q128_Handle_t *hflash, uint32_t base)
+{
+    uint8_t buffer[PACK_READ_ENTRIES * PACK_ENTRY_SIZE];
+    uint32_t directory_end;
+    uint32_t limit;
+    uint16_t count;
+    uint16_t done;
+    uint16_t i;
+    PACK_Status_t status;
+    
+    hpack->hflash = hflash;
+    hpack->base = base;
+    hpack->count = 0;
+    hpack->max_probe = 0;
+    
+    for (i = 0; i < PACK_TABLE_SIZE; i++)
+    {
+        hpack->table[i].offset = 0;
+    }
+    
+    if (base >= hflash->capacity || hflash->capacity - base < PACK_HEADER_SIZE)
+    {
+        return PACK_FORMAT;
+    }
+    limit = hflash->capacity - base;
+    
+    if (W25Q128_Read(hflash, base, buffer, PACK_HEADER_SIZE) != W25Q128_OK)
+    {
+        return PACK_ERROR;
+    }
+    
+    if (PACK_ReadU32(buffer) != PACK_MAGIC)
+    {
+        return PACK_FORMAT;
+    }
+    
+    count = buffer[4] | (buffer[5] << 8);
+    if (count > PACK_MAX_ENTRIES)
+    {
+        return PACK_FULL;
+    }
+    
+    directory_end = PACK_HEADER_SIZE + (uint32_t)count * PACK_ENTRY_SIZE;
+    if (directory_end > limit)
+    {
+        return PACK_FORMAT;
+    }
+    
+    for (done = 0; done < count; done += PACK_READ_ENTRIES)
+    {
+        uint16_t batch = count - done;
+        
+        if (batch > PACK_READ_ENTRIES)
+        {
+            batch = PACK_READ_ENTRIES;
+        }
+        
+        if (W25Q128_Read(hflash, base + PACK_HEADER_SIZE + (uint32_t)done * PACK_ENTRY_SIZE,
+                         buffer, (uint32_t)batch * PACK_ENTRY_SIZE) != W25Q128_OK)
+        {
+            return PACK_ERROR;
+        }
+        
+        for (i = 0; i < batch; i++)
+        {
+            const uint8_t *entry = &buffer[i * PACK_ENTRY_SIZE];
+            uint32_t offset = PACK_ReadU32(&entry[PACK_NAME_SIZE]);
+            uint32_t size = PACK_ReadU32(&entry[PACK_NAME_SIZE + 4]);
+            
+            // Data must lie after the directory and inside the flash
+            if (offset < directory_end || offset > limit || size > limit - offset)
+            {
+                return PACK_FORMAT;
+            }
+            
+            status = PACK_Insert(hpack, PACK_Hash((const char *)entry), offset, size,
+                                 done + i, &hpack->order[done + i]);
+            if (status != PACK_OK)
+            {
+                return status;
+            }
+        }
+    }
+    
+    hpack->count = count;
+    
+    return PACK_OK;
+}
+
+/**
+  * @brief  Check that a directory entry holds a name
+  * @param  hpack: Pointer to pack handle
+  * @param  entry: Directory index
+  * @param  name: Asset name, at most PACK_NAME_SIZE characters
+  * @retval PACK_OK, PACK_NOT_FOUND or PACK_ERROR
+  */
+static PACK_Status_t PACK_MatchName(PACK_Handle_t *hpack, uint16_t entry, const char *name)
+{
+    char stored[PACK_NAME_SIZE];
+    size_t length = strlen(name);
+    
+    if (W25Q128_Read(hpack->hflash, hpack->base + PACK_HEADER_SIZE + (uint32_t)entry * PACK_ENTRY_SIZE,
+                     (uint8_t *)stored, PACK_NAME_SIZE) != W25Q128_OK)
+    {
+        return PACK_ERROR;
+    }
+    
+    // The stored name is NUL padded, or fills all PACK_NAME_SIZE bytes
+    if (memcmp(stored, name, length) != 0 || (length < PACK_NAME_SIZE && stored[length] != '\0'))
+    {
+        return PACK_NOT_FOUND;
+    }
+    
+    return PACK_OK;
+}
+
+/**
+  * @brief  Look up an asset by name
+  * @note   At most max_probe + 1 RAM slots are checked; the slot whose hash
+  *         matches is confirmed with one PACK_NAME_SIZE read of its
+  *         directory entry, so a name that only shares the hash of a
+  *         stored one is not found.
+  * @param  hpack: Pointer to pack handle
+  * @param  name: Asset name (NUL terminated)
+  * @param  address: Returns the flash address of the asset
+  * @param  size: Returns the asset size in bytes
+  * @retval PACK_OK, PACK_NOT_FOUND, or PACK_ERROR if the name check failed to read
+  */
+PACK_Status_t PACK_Find(PACK_Handle_t *hpack, const char *name, uint32_t *address, uint32_t *size)
+{
+    uint32_t hash;
+    uint32_t index;
+    uint8_t probe;
+    PACK_Status_t status;
+    
+    // Longer names cannot be stored (and would hash like their prefix)
+    if (hpack->count == 0 || strnlen(name, PACK_NAME_SIZE + 1) > PACK_NAME_SIZE)
+    {
+        return PACK_NOT_FOUND;
+    }
+    
+    hash = PACK_Hash(name);
+    index = hash & (PACK_TABLE_SIZE - 1);
+    
+    for (probe = 0; probe <= hpack->max_probe; probe++)
+    {
+        PACK_Slot_t *slot = &hpack->table[index];
+        
+        if (slot->offset == 0)
+        {
+            break;
+        }
+        
+        if (slot->hash == hash)
+        {
+            // Hashes are unique in the table: no other slot can hold the name
+            status = PACK_MatchName(hpack, slot->entry, name);
+            if (status != PACK_OK)
+            {
+                return status;
+            }
+            
+            *address = hpack->base + slot->offset;
+            *size = slot->size;
+            return PACK_OK;
+        }
+        
+        index = (index + 1) & (PACK_TABLE_SIZE - 1);
+    }
+    
+    return PACK_NOT_FOUND;
+}
+
+/**
+  * @brief  Look up an asset by its position in the directory
+  * @param  hpack: Pointer to pack handle
+  * @param  index: Directory index (0 to count-1)
+  * @param  address: Returns the flash address of the asset
+  * @param  size: Returns the asset size in bytes
+  * @retval PACK_OK or PACK_NOT_FOUND
+  */
+PACK_Status_t PACK_FindIndex(PACK_Handle_t *hpack, uint16_t index, uint32_t *address, uint32_t *size)
+{
+    PACK_Slot_t *slot;
+    
+    if (index >= hpack->count)
+    {
+        return PACK_NOT_FOUND;
+    }
+    
+    slot = &hpack->table[hpack->order[index]];
+    *address = hpack->base + slot->offset;
+    *size = slot->size;
+    
+    return PACK_OK;
+}
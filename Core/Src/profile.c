@@ -0,0 +1,107 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : profile.c
+  * @brief          : DWT cycle-counter profiling Implementation
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#include "profile.h"
+#include <string.h>
+
+#if PROF_ENABLED
+static PROF_Stats_t prof_stats[PROF_POINT_COUNT];
+#endif
+
+/**
+  * @brief  Start the DWT cycle counter and clear the statistics
+  * @retval None
+  */
+void PROF_Init(void)
+{
+#if PROF_ENABLED
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    
+    PROF_Reset();
+#endif
+}
+
+/**
+  * @brief  Clear the statistics of every point
+  * @retval None
+  */
+void PROF_Reset(void)
+{
+#if PROF_ENABLED
+    memset(prof_stats, 0, sizeof(prof_stats));
+    for (uint8_t i = 0; i < PROF_POINT_COUNT; i++)
+    {
+        prof_stats[i].min = 0xFFFFFFFF;
+    }
+#endif
+}
+
+/**
+  * @brief  Add one call to a point
+  * @param  point: Profiling point
+  * @param  cycles: Duration of the call in HCLK cycles
+  * @retval None
+  */
+void PROF_Record(PROF_Point_t point, uint32_t cycles)
+{
+#if PROF_ENABLED
+    PROF_Stats_t *stats;
+    uint32_t bucket;
+    
+    if (point >= PROF_POINT_COUNT)
+    {
+        return;
+    }
+    
+    stats = &prof_stats[point];
+    
+    // Bit length of cycles: 0 for 0, b for 2^(b-1) .. 2^b - 1
+    bucket = 32 - __CLZ(cycles);
+    if (bucket >= PROF_BUCKETS)
+    {
+        bucket = PROF_BUCKETS - 1;
+    }
+    
+    stats->count++;
+    stats->total += cycles;
+    stats->histogram[bucket]++;
+    if (cycles < stats->min)
+    {
+        stats->min = cycles;
+    }
+    if (cycles > stats->max)
+    {
+        stats->max = cycles;
+    }
+#else
+    UNUSED(point);
+    UNUSED(cycles);
+#endif
+}
+
+/**
+  * @brief  Statistics of a point
+  * @param  point: Profiling point
+  * @retval Pointer to the statistics, NULL when profiling is compiled out
+  */
+const PROF_Stats_t *PROF_GetStats(PROF_Point_t point)
+{
+#if PROF_ENABLED
+    if (point < PROF_POINT_COUNT)
+    {
+        return &prof_stats[point];
+    }
+#else
+    UNUSED(point);
+#endif
+    
+    return NULL;
+}
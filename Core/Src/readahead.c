@@ -0,0 +1,305 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : readahead.c
+  * @brief          : Sequential read-ahead Implementation
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#include "readahead.h"
+#include <string.h>
+
+/**
+  * @brief  Collect a finished prefetch without blocking
+  * @param  hra: Pointer to read-ahead handle
+  * @retval W25Q128_BUSY while the prefetch runs, otherwise W25Q128_OK
+  */
+static W25Q128_Status_t RA_Collect(RA_Handle_t *hra)
+{
+    W25Q128_Status_t status;
+    
+    if (hra->prefetch_slot == RA_NO_SLOT)
+    {
+        return W25Q128_OK;
+    }
+    
+    status = W25Q128_ReadAsyncStatus(hra->hflash);
+    if (status == W25Q128_BUSY)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    // A failed prefetch only costs a blocking read later on
+    if (status != W25Q128_OK)
+    {
+        hra->slots[hra->prefetch_slot].length = 0;
+    }
+    hra->prefetch_slot = RA_NO_SLOT;
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Wait for the running prefetch, if any
+  * @param  hra: Pointer to read-ahead handle
+  * @retval None
+  */
+static void RA_WaitPrefetch(RA_Handle_t *hra)
+{
+    if (hra->prefetch_slot == RA_NO_SLOT)
+    {
+        return;
+    }
+    
+    if (W25Q128_ReadAsyncWait(hra->hflash, W25Q128_TIMEOUT_MS) != W25Q128_OK)
+    {
+        hra->slots[hra->prefetch_slot].length = 0;
+    }
+    hra->prefetch_slot = RA_NO_SLOT;
+}
+
+/**
+  * @brief  Slot holding an address, waiting for it if it is being prefetched
+  * @param  hra: Pointer to read-ahead handle
+  * @param  address: Flash address
+  * @retval Slot index, RA_NO_SLOT if the address is not buffered
+  */
+static uint8_t RA_Find(RA_Handle_t *hra, uint32_t address)
+{
+    uint8_t i;
+    
+    for (i = 0; i < RA_SLOTS; i++)
+    {
+        RA_Slot_t *slot = &hra->slots[i];
+        
+        if (slot->length == 0 || address < slot->address || address - slot->address >= slot->length)
+        {
+            continue;
+        }
+        
+        if (i == hra->prefetch_slot)
+        {
+            RA_WaitPrefetch(hra);
+            if (slot->length == 0)
+            {
+                return RA_NO_SLOT;
+            }
+        }
+        
+        return i;
+    }
+    
+    return RA_NO_SLOT;
+}
+
+/**
+  * @brief  Start fetching the chunk after the buffered data into a free slot
+  * @note   The oldest slot is reused once it holds nothing between the read
+  *         position and the fetch address. Does nothing while a prefetch
+  *         is running.
+  * @param  hra: Pointer to read-ahead handle
+  * @retval None
+  */
+static void RA_Prefetch(RA_Handle_t *hra)
+{
+    RA_Slot_t *slot;
+    uint32_t address;
+    uint32_t length;
+    uint8_t index;
+    uint8_t found;
+    uint8_t i;
+    
+    if (!hra->streaming || RA_Collect(hra) != W25Q128_OK)
+    {
+        return;
+    }
+    
+    // Skip what the ring already holds from the read position on
+    address = hra->next_address;
+    do
+    {
+        found = 0;
+        for (i = 0; i < RA_SLOTS; i++)
+        {
+            slot = &hra->slots[i];
+            if (slot->length > 0 && slot->address <= address && address - slot->address < slot->length)
+            {
+                address = slot->address + slot->length;
+                found = 1;
+            }
+        }
+    } while (found);
+    
+    if (address >= hra->hflash->capacity)
+    {
+        return;
+    }
+    
+    // Oldest slot in ring order, unless it still holds data not read yet
+    index = (hra->head + 1) % RA_SLOTS;
+    slot = &hra->slots[index];
+    if (slot->length > 0 && slot->address < address &&
+        slot->address + slot->length > hra->next_address)
+    {
+        return;
+    }
+    
+    length = hra->hflash->capacity - address;
+    if (length > RA_CHUNK_SIZE)
+    {
+        length = RA_CHUNK_SIZE;
+    }
+    
+    slot->address = address;
+    slot->length = length;
+    hra->prefetch_slot = index;
+    
+    if (W25Q128_ReadAsync(hra->hflash, address, slot->data, length, NULL) != W25Q128_OK)
+    {
+        slot->length = 0;
+        hra->prefetch_slot = RA_NO_SLOT;
+        return;
+    }
+    
+    hra->head = index;
+}
+
+/**
+  * @brief  Initialize read-ahead
+  * @param  hra: Pointer to read-ahead handle
+  * @param  hflash: Initialised flash handle
+  * @retval None
+  */
+void RA_Init(RA_Handle_t *hra, W25Q128_Handle_t *hflash)
+{
+    uint8_t i;
+    
+    hra->hflash = hflash;
+    hra->head = 0;
+    hra->prefetch_slot = RA_NO_SLOT;
+    hra->streaming = 0;
+    hra->next_address = 0;
+    hra->hits = 0;
+    hra->misses = 0;
+    
+    for (i = 0; i < RA_SLOTS; i++)
+    {
+        hra->slots[i].length = 0;
+    }
+}
+
+/**
+  * @brief  Read data, from the ring when possible
+  * @note   A read that starts where the previous one ended turns on
+  *         streaming: misses then load a whole chunk into the ring and the
+  *         next chunk is prefetched in the background. Reads of at least
+  *         RA_CHUNK_SIZE bytes go to the caller's buffer directly.
+  * @param  hra: Pointer to read-ahead handle
+  * @param  address: Start address
+  * @param  buffer: Pointer to data buffer
+  * @param  length: Number of bytes to read
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t RA_Read(RA_Handle_t *hra, uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    W25Q128_Status_t status;
+    
+    if (length == 0 || address >= hra->hflash->capacity || length > hra->hflash->capacity - address)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    RA_Collect(hra);
+    
+    hra->streaming = (address == hra->next_address);
+    
+    while (length > 0)
+    {
+        uint32_t chunk = length;
+        uint8_t index = RA_Find(hra, address);
+        
+        if (index != RA_NO_SLOT)
+        {
+            RA_Slot_t *slot = &hra->slots[index];
+            uint32_t offset = address - slot->address;
+            
+            if (chunk > slot->length - offset)
+            {
+                chunk = slot->length - offset;
+            }
+            
+            memcpy(buffer, &slot->data[offset], chunk);
+            hra->hits += chunk;
+        }
+        else if (hra->streaming && length < RA_CHUNK_SIZE)
+        {
+            // Load the whole chunk, the copy happens on the next pass
+            RA_Slot_t *slot;
+            
+            RA_WaitPrefetch(hra);
+            
+            index = (hra->head + 1) % RA_SLOTS;
+            slot = &hra->slots[index];
+            slot->address = address;
+            slot->length = hra->hflash->capacity - address;
+            if (slot->length > RA_CHUNK_SIZE)
+            {
+                slot->length = RA_CHUNK_SIZE;
+            }
+            
+            status = W25Q128_Read(hra->hflash, address, slot->data, slot->length);
+            hra->misses++;
+            if (status != W25Q128_OK)
+            {
+                slot->length = 0;
+                return status;
+            }
+            
+            hra->head = index;
+            continue;
+        }
+        else
+        {
+            RA_WaitPrefetch(hra);
+            
+            status = W25Q128_Read(hra->hflash, address, buffer, chunk);
+            hra->misses++;
+            if (status != W25Q128_OK)
+            {
+                return status;
+            }
+        }
+        
+        address += chunk;
+        buffer += chunk;
+        length -= chunk;
+        hra->next_address = address;
+        
+        RA_Prefetch(hra);
+    }
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Stop read-ahead and drop every buffered chunk
+  * @note   Waits for a running prefetch, so the flash handle is free
+  *         afterwards. Call after writing or erasing the flash.
+  * @param  hra: Pointer to read-ahead handle
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t RA_Invalidate(RA_Handle_t *hra)
+{
+    uint8_t i;
+    
+    RA_WaitPrefetch(hra);
+    
+    for (i = 0; i < RA_SLOTS; i++)
+    {
+        hra->slots[i].length = 0;
+    }
+    hra->streaming = 0;
+    
+    return W25Q128_OK;
+}
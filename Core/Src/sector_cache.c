@@ -0,0 +1,340 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : sector_cache.c
+  * @brief          : Write-back 4KB sector cache Implementation
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#include "sector_cache.h"
+#include <string.h>
+
+#define SCACHE_PAGES_PER_SECTOR   (W25Q128_SECTOR_SIZE / W25Q128_PAGE_SIZE)
+
+/**
+  * @brief  Cached line holding a sector
+  * @param  hcache: Pointer to cache handle
+  * @param  sector: Sector start address
+  * @retval Pointer to line, NULL if the sector is not cached
+  */
+static SCACHE_Line_t *SCACHE_Lookup(SCACHE_Handle_t *hcache, uint32_t sector)
+{
+    uint8_t i;
+    
+    for (i = 0; i < SCACHE_LINES; i++)
+    {
+        if (hcache->lines[i].valid && hcache->lines[i].sector == sector)
+        {
+            return &hcache->lines[i];
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+  * @brief  Write a dirty line back to flash
+  * @note   The sector is compared with the line one page at a time. When no
+  *         changed bit has to go from 0 to 1, only the changed pages are
+  *         programmed over the old data; otherwise the sector is erased and
+  *         programmed in full.
+  * @param  hcache: Pointer to cache handle
+  * @param  line: Pointer to line
+  * @retval W25Q128_Status_t
+  */
+static W25Q128_Status_t SCACHE_FlushLine(SCACHE_Handle_t *hcache, SCACHE_Line_t *line)
+{
+    uint8_t page[W25Q128_PAGE_SIZE];
+    uint16_t changed = 0;
+    uint8_t need_erase = 0;
+    uint32_t offset;
+    uint32_t i;
+    W25Q128_Status_t status;
+    
+    if (!line->valid || !line->dirty)
+    {
+        return W25Q128_OK;
+    }
+    
+    for (offset = 0; offset < W25Q128_SECTOR_SIZE && !need_erase; offset += W25Q128_PAGE_SIZE)
+    {
+        const uint8_t *data = &line->data[offset];
+        
+        status = W25Q128_Read(hcache->hflash, line->sector + offset, page, W25Q128_PAGE_SIZE);
+        if (status != W25Q128_OK)
+        {
+            return status;
+        }
+        
+        if (memcmp(page, data, W25Q128_PAGE_SIZE) == 0)
+        {
+            continue;
+        }
+        
+        changed |= 1U << (offset / W25Q128_PAGE_SIZE);
+        
+        for (i = 0; i < W25Q128_PAGE_SIZE; i++)
+        {
+            if ((page[i] & data[i]) != data[i])
+            {
+                need_erase = 1;
+                break;
+            }
+        }
+    }
+    
+    if (need_erase)
+    {
+        status = W25Q128_EraseSector(hcache->hflash, line->sector);
+        if (status != W25Q128_OK)
+        {
+            return status;
+        }
+        hcache->erase_count++;
+        
+        status = W25Q128_WriteEx(hcache->hflash, line->sector, line->data,
+                                 W25Q128_SECTOR_SIZE, W25Q128_WRITE_SKIP_BLANK);
+    }
+    else
+    {
+        status = W25Q128_OK;
+        
+        for (i = 0; i < SCACHE_PAGES_PER_SECTOR && status == W25Q128_OK; i++)
+        {
+            if (changed & (1U << i))
+            {
+                status = W25Q128_WriteEx(hcache->hflash, line->sector + i * W25Q128_PAGE_SIZE,
+                                         &line->data[i * W25Q128_PAGE_SIZE],
+                                         W25Q128_PAGE_SIZE, W25Q128_WRITE_SKIP_BLANK);
+            }
+        }
+    }
+    
+    if (status != W25Q128_OK)
+    {
+        return status;
+    }
+    
+    line->dirty = 0;
+    hcache->flush_count++;
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Get the line for a sector, loading it from flash if needed
+  * @note   On a miss the least recently used line is written back (if
+  *         dirty) and reused.
+  * @param  hcache: Pointer to cache handle
+  * @param  sector: Sector start address
+  * @param  line: Returns pointer to line
+  * @retval W25Q128_Status_t
+  */
+static W25Q128_Status_t SCACHE_Fetch(SCACHE_Handle_t *hcache, uint32_t sector, SCACHE_Line_t **line)
+{
+    SCACHE_Line_t *victim;
+    W25Q128_Status_t status;
+    uint8_t i;
+    
+    victim = SCACHE_Lookup(hcache, sector);
+    if (victim == NULL)
+    {
+        // Empty line first, else the oldest one
+        victim = &hcache->lines[0];
+        for (i = 0; i < SCACHE_LINES; i++)
+        {
+            if (!hcache->lines[i].valid)
+            {
+                victim = &hcache->lines[i];
+                break;
+            }
+            if (hcache->lines[i].last_use < victim->last_use)
+            {
+                victim = &hcache->lines[i];
+            }
+        }
+        
+        status = SCACHE_FlushLine(hcache, victim);
+        if (status != W25Q128_OK)
+        {
+            return status;
+        }
+        
+        victim->valid = 0;
+        status = W25Q128_Read(hcache->hflash, sector, victim->data, W25Q128_SECTOR_SIZE);
+        if (status != W25Q128_OK)
+        {
+            return status;
+        }
+        
+        victim->sector = sector;
+        victim->valid = 1;
+        victim->dirty = 0;
+    }
+    
+    victim->last_use = ++hcache->use_counter;
+    *line = victim;
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Initialize a sector cache
+  * @param  hcache: Pointer to cache handle
+  * @param  hflash: Initialised flash handle
+  * @retval None
+  */
+void SCACHE_Init(SCACHE_Handle_t *hcache, W25Q128_Handle_t *hflash)
+{
+    hcache->hflash = hflash;
+    hcache->use_counter = 0;
+    hcache->erase_count = 0;
+    hcache->flush_count = 0;
+    SCACHE_Invalidate(hcache);
+}
+
+/**
+  * @brief  Read data through the cache
+  * @note   Cached sectors are served from RAM, the rest straight from flash
+  *         without allocating a line.
+  * @param  hcache: Pointer to cache handle
+  * @param  address: Start address
+  * @param  buffer: Pointer to data buffer
+  * @param  length: Number of bytes to read
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t SCACHE_Read(SCACHE_Handle_t *hcache, uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    W25Q128_Status_t status;
+    
+    if (address >= hcache->hflash->capacity || length > hcache->hflash->capacity - address)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    while (length > 0)
+    {
+        uint32_t offset = address % W25Q128_SECTOR_SIZE;
+        uint32_t chunk = W25Q128_SECTOR_SIZE - offset;
+        SCACHE_Line_t *line;
+        
+        if (chunk > length)
+        {
+            chunk = length;
+        }
+        
+        line = SCACHE_Lookup(hcache, address - offset);
+        if (line != NULL)
+        {
+            memcpy(buffer, &line->data[offset], chunk);
+            line->last_use = ++hcache->use_counter;
+        }
+        else
+        {
+            status = W25Q128_Read(hcache->hflash, address, buffer, chunk);
+            if (status != W25Q128_OK)
+            {
+                return status;
+            }
+        }
+        
+        address += chunk;
+        buffer += chunk;
+        length -= chunk;
+    }
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Write data into the cache
+  * @note   No erase is needed beforehand; the data reaches flash on
+  *         SCACHE_Flush or when its line is evicted.
+  * @param  hcache: Pointer to cache handle
+  * @param  address: Start address
+  * @param  buffer: Pointer to data buffer
+  * @param  length: Number of bytes to write
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t SCACHE_Write(SCACHE_Handle_t *hcache, uint32_t address, const uint8_t *buffer, uint32_t length)
+{
+    W25Q128_Status_t status;
+    
+    if (address >= hcache->hflash->capacity || length > hcache->hflash->capacity - address)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    while (length > 0)
+    {
+        uint32_t offset = address % W25Q128_SECTOR_SIZE;
+        uint32_t chunk = W25Q128_SECTOR_SIZE - offset;
+        SCACHE_Line_t *line;
+        
+        if (chunk > length)
+        {
+            chunk = length;
+        }
+        
+        status = SCACHE_Fetch(hcache, address - offset, &line);
+        if (status != W25Q128_OK)
+        {
+            return status;
+        }
+        
+        if (memcmp(&line->data[offset], buffer, chunk) != 0)
+        {
+            memcpy(&line->data[offset], buffer, chunk);
+            line->dirty = 1;
+        }
+        
+        address += chunk;
+        buffer += chunk;
+        length -= chunk;
+    }
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Write all dirty lines back to flash
+  * @note   Lines stay cached (clean) after the flush.
+  * @param  hcache: Pointer to cache handle
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t SCACHE_Flush(SCACHE_Handle_t *hcache)
+{
+    W25Q128_Status_t status;
+    uint8_t i;
+    
+    for (i = 0; i < SCACHE_LINES; i++)
+    {
+        status = SCACHE_FlushLine(hcache, &hcache->lines[i]);
+        if (status != W25Q128_OK)
+        {
+            return status;
+        }
+    }
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Drop every line without writing it back
+  * @note   Call after changing the flash directly, or to discard unflushed
+  *         writes.
+  * @param  hcache: Pointer to cache handle
+  * @retval None
+  */
+void SCACHE_Invalidate(SCACHE_Handle_t *hcache)
+{
+    uint8_t i;
+    
+    for (i = 0; i < SCACHE_LINES; i++)
+    {
+        hcache->lines[i].valid = 0;
+        hcache->lines[i].dirty = 0;
+        hcache->lines[i].last_use = 0;
+    }
+}
@@ -10,6 +10,196 @@
 #include "uart_bootloader.h"
 #include <string.h>
 
+#if BOOT_CRC16_SLICE_BY_4
+#define BOOT_CRC16_TABLES         4
+#else
+#define BOOT_CRC16_TABLES         1
+#endif
+
+/* Double buffer for streaming flash reads (verify/hash), one chunk per half */
+static uint8_t boot_stream_buffer[2][BOOT_MAX_DATA_SIZE];
+
+/* CRC-16/CCITT (poly 0x1021) lookup tables, kept in flash. Table 0 is the
+   CRC of byte i; table k the CRC of byte i followed by k zero bytes. */
+static const uint16_t boot_crc16_table[BOOT_CRC16_TABLES][256] = {
+    {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+        0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+        0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+        0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+        0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+        0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+        0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+        0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+        0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+        0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+        0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+        0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+        0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+        0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+        0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+        0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+        0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+        0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+        0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+        0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+        0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+        0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+        0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+        0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+        0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+        0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+        0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+        0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+        0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+        0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+        0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+    },
+#if BOOT_CRC16_SLICE_BY_4
+    {
+        0x0000, 0x3331, 0x6662, 0x5553, 0xCCC4, 0xFFF5, 0xAAA6, 0x9997,
+        0x89A9, 0xBA98, 0xEFCB, 0xDCFA, 0x456D, 0x765C, 0x230F, 0x103E,
+        0x0373, 0x3042, 0x6511, 0x5620, 0xCFB7, 0xFC86, 0xA9D5, 0x9AE4,
+        0x8ADA, 0xB9EB, 0xECB8, 0xDF89, 0x461E, 0x752F, 0x207C, 0x134D,
+        0x06E6, 0x35D7, 0x6084, 0x53B5, 0xCA22, 0xF913, 0xAC40, 0x9F71,
+        0x8F4F, 0xBC7E, 0xE92D, 0xDA1C, 0x438B, 0x70BA, 0x25E9, 0x16D8,
+        0x0595, 0x36A4, 0x63F7, 0x50C6, 0xC951, 0xFA60, 0xAF33, 0x9C02,
+        0x8C3C, 0xBF0D, 0xEA5E, 0xD96F, 0x40F8, 0x73C9, 0x269A, 0x15AB,
+        0x0DCC, 0x3EFD, 0x6BAE, 0x589F, 0xC108, 0xF239, 0xA76A, 0x945B,
+        0x8465, 0xB754, 0xE207, 0xD136, 0x48A1, 0x7B90, 0x2EC3, 0x1DF2,
+        0x0EBF, 0x3D8E, 0x68DD, 0x5BEC, 0xC27B, 0xF14A, 0xA419, 0x9728,
+        0x8716, 0xB427, 0xE174, 0xD245, 0x4BD2, 0x78E3, 0x2DB0, 0x1E81,
+        0x0B2A, 0x381B, 0x6D48, 0x5E79, 0xC7EE, 0xF4DF, 0xA18C, 0x92BD,
+        0x8283, 0xB1B2, 0xE4E1, 0xD7D0, 0x4E47, 0x7D76, 0x2825, 0x1B14,
+        0x0859, 0x3B68, 0x6E3B, 0x5D0A, 0xC49D, 0xF7AC, 0xA2FF, 0x91CE,
+        0x81F0, 0xB2C1, 0xE792, 0xD4A3, 0x4D34, 0x7E05, 0x2B56, 0x1867,
+        0x1B98, 0x28A9, 0x7DFA, 0x4ECB, 0xD75C, 0xE46D, 0xB13E, 0x820F,
+        0x9231, 0xA100, 0xF453, 0xC762, 0x5EF5, 0x6DC4, 0x3897, 0x0BA6,
+        0x18EB, 0x2BDA, 0x7E89, 0x4DB8, 0xD42F, 0xE71E, 0xB24D, 0x817C,
+        0x9142, 0xA273, 0xF720, 0xC411, 0x5D86, 0x6EB7, 0x3BE4, 0x08D5,
+        0x1D7E, 0x2E4F, 0x7B1C, 0x482D, 0xD1BA, 0xE28B, 0xB7D8, 0x84E9,
+        0x94D7, 0xA7E6, 0xF2B5, 0xC184, 0x5813, 0x6B22, 0x3E71, 0x0D40,
+        0x1E0D, 0x2D3C, 0x786F, 0x4B5E, 0xD2C9, 0xE1F8, 0xB4AB, 0x879A,
+        0x97A4, 0xA495, 0xF1C6, 0xC2F7, 0x5B60, 0x6851, 0x3D02, 0x0E33,
+        0x1654, 0x2565, 0x7036, 0x4307, 0xDA90, 0xE9A1, 0xBCF2, 0x8FC3,
+        0x9FFD, 0xACCC, 0xF99F, 0xCAAE, 0x5339, 0x6008, 0x355B, 0x066A,
+        0x1527, 0x2616, 0x7345, 0x4074, 0xD9E3, 0xEAD2, 0xBF81, 0x8CB0,
+        0x9C8E, 0xAFBF, 0xFAEC, 0xC9DD, 0x504A, 0x637B, 0x3628, 0x0519,
+        0x10B2, 0x2383, 0x76D0, 0x45E1, 0xDC76, 0xEF47, 0xBA14, 0x8925,
+        0x991B, 0xAA2A, 0xFF79, 0xCC48, 0x55DF, 0x66EE, 0x33BD, 0x008C,
+        0x13C1, 0x20F0, 0x75A3, 0x4692, 0xDF05, 0xEC34, 0xB967, 0x8A56,
+        0x9A68, 0xA959, 0xFC0A, 0xCF3B, 0x56AC, 0x659D, 0x30CE, 0x03FF
+    },
+    {
+        0x0000, 0x3730, 0x6E60, 0x5950, 0xDCC0, 0xEBF0, 0xB2A0, 0x8590,
+        0xA9A1, 0x9E91, 0xC7C1, 0xF0F1, 0x7561, 0x4251, 0x1B01, 0x2C31,
+        0x4363, 0x7453, 0x2D03, 0x1A33, 0x9FA3, 0xA893, 0xF1C3, 0xC6F3,
+        0xEAC2, 0xDDF2, 0x84A2, 0xB392, 0x3602, 0x0132, 0x5862, 0x6F52,
+        0x86C6, 0xB1F6, 0xE8A6, 0xDF96, 0x5A06, 0x6D36, 0x3466, 0x0356,
+        0x2F67, 0x1857, 0x4107, 0x7637, 0xF3A7, 0xC497, 0x9DC7, 0xAAF7,
+        0xC5A5, 0xF295, 0xABC5, 0x9CF5, 0x1965, 0x2E55, 0x7705, 0x4035,
+        0x6C04, 0x5B34, 0x0264, 0x3554, 0xB0C4, 0x87F4, 0xDEA4, 0xE994,
+        0x1DAD, 0x2A9D, 0x73CD, 0x44FD, 0xC16D, 0xF65D, 0xAF0D, 0x983D,
+        0xB40C, 0x833C, 0xDA6C, 0xED5C, 0x68CC, 0x5FFC, 0x06AC, 0x319C,
+        0x5ECE, 0x69FE, 0x30AE, 0x079E, 0x820E, 0xB53E, 0xEC6E, 0xDB5E,
+        0xF76F, 0xC05F, 0x990F, 0xAE3F, 0x2BAF, 0x1C9F, 0x45CF, 0x72FF,
+        0x9B6B, 0xAC5B, 0xF50B, 0xC23B, 0x47AB, 0x709B, 0x29CB, 0x1EFB,
+        0x32CA, 0x05FA, 0x5CAA, 0x6B9A, 0xEE0A, 0xD93A, 0x806A, 0xB75A,
+        0xD808, 0xEF38, 0xB668, 0x8158, 0x04C8, 0x33F8, 0x6AA8, 0x5D98,
+        0x71A9, 0x4699, 0x1FC9, 0x28F9, 0xAD69, 0x9A59, 0xC309, 0xF439,
+        0x3B5A, 0x0C6A, 0x553A, 0x620A, 0xE79A, 0xD0AA, 0x89FA, 0xBECA,
+        0x92FB, 0xA5CB, 0xFC9B, 0xCBAB, 0x4E3B, 0x790B, 0x205B, 0x176B,
+        0x7839, 0x4F09, 0x1659, 0x2169, 0xA4F9, 0x93C9, 0xCA99, 0xFDA9,
+        0xD198, 0xE6A8, 0xBFF8, 0x88C8, 0x0D58, 0x3A68, 0x6338, 0x5408,
+        0xBD9C, 0x8AAC, 0xD3FC, 0xE4CC, 0x615C, 0x566C, 0x0F3C, 0x380C,
+        0x143D, 0x230D, 0x7A5D, 0x4D6D, 0xC8FD, 0xFFCD, 0xA69D, 0x91AD,
+        0xFEFF, 0xC9CF, 0x909F, 0xA7AF, 0x223F, 0x150F, 0x4C5F, 0x7B6F,
+        0x575E, 0x606E, 0x393E, 0x0E0E, 0x8B9E, 0xBCAE, 0xE5FE, 0xD2CE,
+        0x26F7, 0x11C7, 0x4897, 0x7FA7, 0xFA37, 0xCD07, 0x9457, 0xA367,
+        0x8F56, 0xB866, 0xE136, 0xD606, 0x5396, 0x64A6, 0x3DF6, 0x0AC6,
+        0x6594, 0x52A4, 0x0BF4, 0x3CC4, 0xB954, 0x8E64, 0xD734, 0xE004,
+        0xCC35, 0xFB05, 0xA255, 0x9565, 0x10F5, 0x27C5, 0x7E95, 0x49A5,
+        0xA031, 0x9701, 0xCE51, 0xF961, 0x7CF1, 0x4BC1, 0x1291, 0x25A1,
+        0x0990, 0x3EA0, 0x67F0, 0x50C0, 0xD550, 0xE260, 0xBB30, 0x8C00,
+        0xE352, 0xD462, 0x8D32, 0xBA02, 0x3F92, 0x08A2, 0x51F2, 0x66C2,
+        0x4AF3, 0x7DC3, 0x2493, 0x13A3, 0x9633, 0xA103, 0xF853, 0xCF63
+    },
+    {
+        0x0000, 0x76B4, 0xED68, 0x9BDC, 0xCAF1, 0xBC45, 0x2799, 0x512D,
+        0x85C3, 0xF377, 0x68AB, 0x1E1F, 0x4F32, 0x3986, 0xA25A, 0xD4EE,
+        0x1BA7, 0x6D13, 0xF6CF, 0x807B, 0xD156, 0xA7E2, 0x3C3E, 0x4A8A,
+        0x9E64, 0xE8D0, 0x730C, 0x05B8, 0x5495, 0x2221, 0xB9FD, 0xCF49,
+        0x374E, 0x41FA, 0xDA26, 0xAC92, 0xFDBF, 0x8B0B, 0x10D7, 0x6663,
+        0xB28D, 0xC439, 0x5FE5, 0x2951, 0x787C, 0x0EC8, 0x9514, 0xE3A0,
+        0x2CE9, 0x5A5D, 0xC181, 0xB735, 0xE618, 0x90AC, 0x0B70, 0x7DC4,
+        0xA92A, 0xDF9E, 0x4442, 0x32F6, 0x63DB, 0x156F, 0x8EB3, 0xF807,
+        0x6E9C, 0x1828, 0x83F4, 0xF540, 0xA46D, 0xD2D9, 0x4905, 0x3FB1,
+        0xEB5F, 0x9DEB, 0x0637, 0x7083, 0x21AE, 0x571A, 0xCCC6, 0xBA72,
+        0x753B, 0x038F, 0x9853, 0xEEE7, 0xBFCA, 0xC97E, 0x52A2, 0x2416,
+        0xF0F8, 0x864C, 0x1D90, 0x6B24, 0x3A09, 0x4CBD, 0xD761, 0xA1D5,
+        0x59D2, 0x2F66, 0xB4BA, 0xC20E, 0x9323, 0xE597, 0x7E4B, 0x08FF,
+        0xDC11, 0xAAA5, 0x3179, 0x47CD, 0x16E0, 0x6054, 0xFB88, 0x8D3C,
+        0x4275, 0x34C1, 0xAF1D, 0xD9A9, 0x8884, 0xFE30, 0x65EC, 0x1358,
+        0xC7B6, 0xB102, 0x2ADE, 0x5C6A, 0x0D47, 0x7BF3, 0xE02F, 0x969B,
+        0xDD38, 0xAB8C, 0x3050, 0x46E4, 0x17C9, 0x617D, 0xFAA1, 0x8C15,
+        0x58FB, 0x2E4F, 0xB593, 0xC327, 0x920A, 0xE4BE, 0x7F62, 0x09D6,
+        0xC69F, 0xB02B, 0x2BF7, 0x5D43, 0x0C6E, 0x7ADA, 0xE106, 0x97B2,
+        0x435C, 0x35E8, 0xAE34, 0xD880, 0x89AD, 0xFF19, 0x64C5, 0x1271,
+        0xEA76, 0x9CC2, 0x071E, 0x71AA, 0x2087, 0x5633, 0xCDEF, 0xBB5B,
+        0x6FB5, 0x1901, 0x82DD, 0xF469, 0xA544, 0xD3F0, 0x482C, 0x3E98,
+        0xF1D1, 0x8765, 0x1CB9, 0x6A0D, 0x3B20, 0x4D94, 0xD648, 0xA0FC,
+        0x7412, 0x02A6, 0x997A, 0xEFCE, 0xBEE3, 0xC857, 0x538B, 0x253F,
+        0xB3A4, 0xC510, 0x5ECC, 0x2878, 0x7955, 0x0FE1, 0x943D, 0xE289,
+        0x3667, 0x40D3, 0xDB0F, 0xADBB, 0xFC96, 0x8A22, 0x11FE, 0x674A,
+        0xA803, 0xDEB7, 0x456B, 0x33DF, 0x62F2, 0x1446, 0x8F9A, 0xF92E,
+        0x2DC0, 0x5B74, 0xC0A8, 0xB61C, 0xE731, 0x9185, 0x0A59, 0x7CED,
+        0x84EA, 0xF25E, 0x6982, 0x1F36, 0x4E1B, 0x38AF, 0xA373, 0xD5C7,
+        0x0129, 0x779D, 0xEC41, 0x9AF5, 0xCBD8, 0xBD6C, 0x26B0, 0x5004,
+        0x9F4D, 0xE9F9, 0x7225, 0x0491, 0x55BC, 0x2308, 0xB8D4, 0xCE60,
+        0x1A8E, 0x6C3A, 0xF7E6, 0x8152, 0xD07F, 0xA6CB, 0x3D17, 0x4BA3
+    }
+#endif
+};
+
+/**
+  * @brief  Continue a CRC16 (CCITT) over more data
+  * @note   Start with BOOT_CRC16_INIT; feeding a buffer in pieces gives the
+  *         same result as one BOOT_CalculateCRC16 call over all of it. With
+  *         BOOT_CRC16_SLICE_BY_4 four bytes are folded in per step.
+  * @param  crc: CRC16 of the data so far
+  * @param  data: Pointer to data buffer
+  * @param  length: Length of data
+  * @retval CRC16 value
+  */
+uint16_t BOOT_UpdateCRC16(uint16_t crc, const uint8_t *data, uint32_t length)
+{
+    PROF_START(crc_start);
+    
+#if BOOT_CRC16_SLICE_BY_4
+    while (length >= 4)
+    {
+        crc = boot_crc16_table[3][data[0] ^ (crc >> 8)] ^
+              boot_crc16_table[2][data[1] ^ (crc & 0xFF)] ^
+              boot_crc16_table[1][data[2]] ^
+              boot_crc16_table[0][data[3]];
+        data += 4;
+        length -= 4;
+    }
+#endif
+    
+    while (length > 0)
+    {
+        crc = (uint16_t)(crc << 8) ^ boot_crc16_table[0][(crc >> 8) ^ *data];
+        data++;
+        length--;
+    }
+    
+    PROF_STOP(PROF_BOOT_CRC16, crc_start);
+    
+    return crc;
+}
+
 /**
   * @brief  Calculate CRC16 (CCITT)
   * @param  data: Pointer to data buffer
@@ -18,21 +208,57 @@
   */
 uint16_t BOOT_CalculateCRC16(uint8_t *data, uint32_t length)
 {
-    uint16_t crc = 0xFFFF;
+    return BOOT_UpdateCRC16(BOOT_CRC16_INIT, data, length);
+}
+
+/**
+  * @brief  Start (or restart) circular DMA reception into the RX ring
+  * @param  hboot: Pointer to bootloader handle
+  * @retval None
+  */
+static void BOOT_StartReceive(BOOT_Handle_t *hboot)
+{
+    hboot->rx_tail = 0;
+    hboot->rx_dma = 0;
+    
+    if (hboot->huart->hdmarx == NULL)
+    {
+        return;
+    }
+    
+    if (HAL_UART_Receive_DMA(hboot->huart, hboot->rx_ring, BOOT_RX_RING_SIZE) == HAL_OK)
+    {
+        hboot->rx_dma = 1;
+    }
+}
+
+/**
+  * @brief  Calculate CRC32 (IEEE 802.3, reflected, as zlib.crc32)
+  * @note   Pass 0 for the first block and the previous result to continue.
+  * @param  crc: Previous CRC32 value
+  * @param  data: Pointer to data buffer
+  * @param  length: Length of data
+  * @retval CRC32 value
+  */
+uint32_t BOOT_CalculateCRC32(uint32_t crc, uint8_t *data, uint32_t length)
+{
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    
+    crc = ~crc;
     
     for (uint32_t i = 0; i < length; i++)
     {
-        crc ^= (uint16_t)data[i] << 8;
-        for (uint8_t j = 0; j < 8; j++)
-        {
-            if (crc & 0x8000)
-                crc = (crc << 1) ^ 0x1021;
-            else
-                crc <<= 1;
-        }
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
     }
     
-    return crc;
+    return ~crc;
 }
 
 /**
@@ -40,15 +266,32 @@ uint16_t BOOT_CalculateCRC16(uint8_t *data, uint32_t length)
   * @param  hboot: Pointer to bootloader handle
   * @param  huart: Pointer to UART handle
   * @param  hflash: Pointer to W25Q128 handle
+  * @param  hcrc: Pointer to CRC handle (NULL: no BOOT_INTEGRITY_CRC32)
   * @retval None
   */
-void BOOT_Init(BOOT_Handle_t *hboot, UART_HandleTypeDef *huart, W25Q128_Handle_t *hflash)
+void BOOT_Init(BOOT_Handle_t *hboot, UART_HandleTypeDef *huart, W25Q128_Handle_t *hflash, CRC_HandleTypeDef *hcrc)
 {
     hboot->huart = huart;
     hboot->hflash = hflash;
+    hboot->hcrc = hcrc;
+    hboot->integrity = BOOT_INTEGRITY_CRC16;
     hboot->total_bytes_written = 0;
     hboot->total_bytes_read = 0;
+    hboot->write_error = 0;
+    hboot->write_error_address = BOOT_NO_ADDRESS;
+    hboot->window_next_seq = 0;
+    hboot->job_state = BOOT_JOB_IDLE;
+    hboot->job_command = 0;
+    hboot->job_address = 0;
+    hboot->job_step = 0;
+    hboot->job_start = 0;
+    hboot->job_end = 0;
+    hboot->job_start_tick = 0;
+    hboot->job_elapsed_ms = 0;
+    hboot->default_baudrate = huart->Init.BaudRate;
     memset(hboot->rx_buffer, 0, BOOT_BUFFER_SIZE);
+    
+    BOOT_StartReceive(hboot);
 }
 
 /**
@@ -82,6 +325,103 @@ BOOT_Status_t BOOT_SendData(BOOT_Handle_t *hboot, uint8_t *data, uint32_t length
     return BOOT_OK;
 }
 
+/**
+  * @brief  Number of received bytes waiting in the RX ring
+  * @param  hboot: Pointer to bootloader handle
+  * @retval Byte count
+  */
+static uint32_t BOOT_RxAvailable(BOOT_Handle_t *hboot)
+{
+    uint32_t head = BOOT_RX_RING_SIZE - __HAL_DMA_GET_COUNTER(hboot->huart->hdmarx);
+    
+    return (head + BOOT_RX_RING_SIZE - hboot->rx_tail) % BOOT_RX_RING_SIZE;
+}
+
+/**
+  * @brief  Receive data via UART, optionally updating a CRC16 on the way
+  * @note   With RX DMA the CRC is folded in chunk by chunk as bytes arrive,
+  *         so it runs while the rest of the packet is still on the wire.
+  * @param  hboot: Pointer to bootloader handle
+  * @param  buffer: Pointer to receive buffer
+  * @param  length: Number of bytes to receive
+  * @param  timeout: Timeout in ms (HAL_MAX_DELAY waits forever)
+  * @param  crc: CRC16 to update with the received bytes (may be NULL)
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_ReceiveDataCRC(BOOT_Handle_t *hboot, uint8_t *buffer, uint32_t length, uint32_t timeout, uint16_t *crc)
+{
+    uint32_t start = HAL_GetTick();
+    
+    if (!hboot->rx_dma)
+    {
+        if (HAL_UART_Receive(hboot->huart, buffer, length, timeout) != HAL_OK)
+        {
+            return BOOT_TIMEOUT;
+        }
+        if (crc != NULL)
+        {
+            *crc = BOOT_UpdateCRC16(*crc, buffer, length);
+        }
+        return BOOT_OK;
+    }
+    
+    // DMA stopped (e.g. after a UART error): restart it, pending bytes are lost
+    if (hboot->huart->RxState != HAL_UART_STATE_BUSY_RX)
+    {
+        BOOT_StartReceive(hboot);
+    }
+    
+    while (length > 0)
+    {
+        uint32_t available = BOOT_RxAvailable(hboot);
+        
+        if (available == 0)
+        {
+            if ((HAL_GetTick() - start) > timeout)
+            {
+                return BOOT_TIMEOUT;
+            }
+            continue;
+        }
+        
+        uint32_t chunk = (available > length) ? length : available;
+        uint32_t to_end = BOOT_RX_RING_SIZE - hboot->rx_tail;
+        
+        if (chunk > to_end)
+        {
+            memcpy(buffer, &hboot->rx_ring[hboot->rx_tail], to_end);
+            memcpy(buffer + to_end, hboot->rx_ring, chunk - to_end);
+        }
+        else
+        {
+            memcpy(buffer, &hboot->rx_ring[hboot->rx_tail], chunk);
+        }
+        
+        hboot->rx_tail = (hboot->rx_tail + chunk) % BOOT_RX_RING_SIZE;
+        if (crc != NULL)
+        {
+            *crc = BOOT_UpdateCRC16(*crc, buffer, chunk);
+        }
+        buffer += chunk;
+        length -= chunk;
+    }
+    
+    return BOOT_OK;
+}
+
+/**
+  * @brief  Receive data via UART with explicit timeout
+  * @param  hboot: Pointer to bootloader handle
+  * @param  buffer: Pointer to receive buffer
+  * @param  length: Number of bytes to receive
+  * @param  timeout: Timeout in ms (HAL_MAX_DELAY waits forever)
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_ReceiveDataTimeout(BOOT_Handle_t *hboot, uint8_t *buffer, uint32_t length, uint32_t timeout)
+{
+    return BOOT_ReceiveDataCRC(hboot, buffer, length, timeout, NULL);
+}
+
 /**
   * @brief  Receive data via UART with timeout
   * @param  hboot: Pointer to bootloader handle
@@ -91,11 +431,86 @@ BOOT_Status_t BOOT_SendData(BOOT_Handle_t *hboot, uint8_t *data, uint32_t length
   */
 static BOOT_Status_t BOOT_ReceiveData(BOOT_Handle_t *hboot, uint8_t *buffer, uint32_t length)
 {
-    if (HAL_UART_Receive(hboot->huart, buffer, length, BOOT_TIMEOUT_MS) != HAL_OK)
+    return BOOT_ReceiveDataTimeout(hboot, buffer, length, BOOT_TIMEOUT_MS);
+}
+
+/**
+  * @brief  CRC32 of a packet on the CRC unit
+  * @note   CRC-32/MPEG-2 over little endian words; a partial last word is
+  *         padded with zero bytes.
+  * @param  hboot: Pointer to bootloader handle
+  * @param  data: Pointer to data buffer (word aligned)
+  * @param  length: Length of data
+  * @retval CRC32 value
+  */
+static uint32_t BOOT_HardwareCRC32(BOOT_Handle_t *hboot, uint8_t *data, uint32_t length)
+{
+    uint32_t words = length / 4;
+    uint32_t tail = 0;
+    uint32_t crc;
+    
+    crc = HAL_CRC_Calculate(hboot->hcrc, (uint32_t *)data, words);
+    
+    if (length % 4)
+    {
+        memcpy(&tail, &data[words * 4], length % 4);
+        crc = HAL_CRC_Accumulate(hboot->hcrc, &tail, 1);
+    }
+    
+    return crc;
+}
+
+/**
+  * @brief  Receive the checksum of a packet and check it
+  * @param  hboot: Pointer to bootloader handle
+  * @param  data: Received bytes covered by the checksum (word aligned)
+  * @param  length: Number of covered bytes
+  * @param  crc16: CRC16 folded in while the bytes were received
+  * @retval BOOT_OK, BOOT_TIMEOUT or BOOT_CRC_ERR
+  */
+static BOOT_Status_t BOOT_ReceiveChecksum(BOOT_Handle_t *hboot, uint8_t *data, uint32_t length, uint16_t crc16)
+{
+    uint8_t buffer[4];
+    
+    if (hboot->integrity == BOOT_INTEGRITY_CRC32)
+    {
+        uint32_t crc_received;
+        
+        if (BOOT_ReceiveData(hboot, buffer, 4) != BOOT_OK)
+        {
+            return BOOT_TIMEOUT;
+        }
+        crc_received = (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | 
+                       ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+        
+        return (crc_received == BOOT_HardwareCRC32(hboot, data, length)) ? BOOT_OK : BOOT_CRC_ERR;
+    }
+    
+    if (BOOT_ReceiveData(hboot, buffer, 2) != BOOT_OK)
     {
         return BOOT_TIMEOUT;
     }
-    return BOOT_OK;
+    
+    return (((uint16_t)buffer[0] | ((uint16_t)buffer[1] << 8)) == crc16) ? BOOT_OK : BOOT_CRC_ERR;
+}
+
+/**
+  * @brief  Send a write/sync NACK followed by the address that failed
+  * @param  hboot: Pointer to bootloader handle
+  * @param  failed_address: Packet whose programming failed, or BOOT_NO_ADDRESS
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_SendWriteNack(BOOT_Handle_t *hboot, uint32_t failed_address)
+{
+    uint8_t buffer[5];
+    
+    buffer[0] = BOOT_NACK;
+    buffer[1] = failed_address & 0xFF;
+    buffer[2] = (failed_address >> 8) & 0xFF;
+    buffer[3] = (failed_address >> 16) & 0xFF;
+    buffer[4] = (failed_address >> 24) & 0xFF;
+    
+    return BOOT_SendData(hboot, buffer, 5);
 }
 
 /**
@@ -108,13 +523,15 @@ static BOOT_Status_t BOOT_HandleWrite(BOOT_Handle_t *hboot)
     uint8_t buffer[8];
     uint32_t data_length;
     uint32_t address;
-    uint16_t crc_received, crc_calculated;
+    uint16_t crc_calculated = BOOT_CRC16_INIT;
+    uint16_t *crc_fold = (hboot->integrity == BOOT_INTEGRITY_CRC16) ? &crc_calculated : NULL;
+    BOOT_Status_t status;
     uint8_t *data_buffer;
     
     // Receive data length (4 bytes)
     if (BOOT_ReceiveData(hboot, buffer, 4) != BOOT_OK)
     {
-        BOOT_SendResponse(hboot, BOOT_NACK);
+        BOOT_SendWriteNack(hboot, BOOT_NO_ADDRESS);
         return BOOT_TIMEOUT;
     }
     data_length = (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | 
@@ -123,60 +540,63 @@ static BOOT_Status_t BOOT_HandleWrite(BOOT_Handle_t *hboot)
     // Check if data length is valid
     if (data_length == 0 || data_length > BOOT_MAX_DATA_SIZE)
     {
-        BOOT_SendResponse(hboot, BOOT_NACK);
+        BOOT_SendWriteNack(hboot, BOOT_NO_ADDRESS);
         return BOOT_ERROR;
     }
     
     // Receive address (4 bytes)
     if (BOOT_ReceiveData(hboot, buffer, 4) != BOOT_OK)
     {
-        BOOT_SendResponse(hboot, BOOT_NACK);
+        BOOT_SendWriteNack(hboot, BOOT_NO_ADDRESS);
         return BOOT_TIMEOUT;
     }
     address = (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | 
               ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
     
     // Allocate buffer for data (use static buffer to avoid stack overflow)
-    static uint8_t large_buffer[BOOT_MAX_DATA_SIZE];
+    static uint8_t large_buffer[BOOT_MAX_DATA_SIZE] __ALIGNED(4);
     data_buffer = large_buffer;
     
-    // Receive data
-    uint32_t remaining = data_length;
-    uint32_t offset = 0;
-    while (remaining > 0)
+    // Receive data, calculating the CRC16 as it comes in
+    if (BOOT_ReceiveDataCRC(hboot, data_buffer, data_length, BOOT_TIMEOUT_MS, crc_fold) != BOOT_OK)
     {
-        uint32_t chunk_size = (remaining > BOOT_BUFFER_SIZE) ? BOOT_BUFFER_SIZE : remaining;
-        if (BOOT_ReceiveData(hboot, &data_buffer[offset], chunk_size) != BOOT_OK)
-        {
-            BOOT_SendResponse(hboot, BOOT_NACK);
-            return BOOT_TIMEOUT;
-        }
-        offset += chunk_size;
-        remaining -= chunk_size;
+        BOOT_SendWriteNack(hboot, BOOT_NO_ADDRESS);
+        return BOOT_TIMEOUT;
     }
     
-    // Receive CRC (2 bytes)
-    if (BOOT_ReceiveData(hboot, buffer, 2) != BOOT_OK)
+    // Receive and verify CRC (2 bytes, or 4 in CRC32 mode)
+    status = BOOT_ReceiveChecksum(hboot, data_buffer, data_length, crc_calculated);
+    if (status != BOOT_OK)
     {
-        BOOT_SendResponse(hboot, BOOT_NACK);
-        return BOOT_TIMEOUT;
+        BOOT_SendWriteNack(hboot, BOOT_NO_ADDRESS);
+        return status;
+    }
+    
+#if BOOT_PIPELINED_WRITE
+    // Report a failed program of the previous packet before accepting this one
+    if (hboot->write_error)
+    {
+        hboot->write_error = 0;
+        BOOT_SendWriteNack(hboot, hboot->write_error_address);
+        return BOOT_ERROR;
     }
-    crc_received = (uint16_t)buffer[0] | ((uint16_t)buffer[1] << 8);
     
-    // Calculate CRC
-    crc_calculated = BOOT_CalculateCRC16(data_buffer, data_length);
+    // ACK first so the host streams the next packet into the RX ring while we program
+    BOOT_SendResponse(hboot, BOOT_ACK);
     
-    // Verify CRC
-    if (crc_received != crc_calculated)
+    if (W25Q128_WriteEx(hboot->hflash, address, data_buffer, data_length, BOOT_WRITE_FLAGS) != W25Q128_OK)
     {
-        BOOT_SendResponse(hboot, BOOT_NACK);
-        return BOOT_CRC_ERR;
+        hboot->write_error = 1;
+        hboot->write_error_address = address;
+        return BOOT_ERROR;
     }
     
+    hboot->total_bytes_written += data_length;
+#else
     // Write data to flash
-    if (W25Q128_Write(hboot->hflash, address, data_buffer, data_length) != W25Q128_OK)
+    if (W25Q128_WriteEx(hboot->hflash, address, data_buffer, data_length, BOOT_WRITE_FLAGS) != W25Q128_OK)
     {
-        BOOT_SendResponse(hboot, BOOT_NACK);
+        BOOT_SendWriteNack(hboot, address);
         return BOOT_ERROR;
     }
     
@@ -184,6 +604,100 @@ static BOOT_Status_t BOOT_HandleWrite(BOOT_Handle_t *hboot)
     
     // Send ACK
     BOOT_SendResponse(hboot, BOOT_ACK);
+#endif
+    
+    return BOOT_OK;
+}
+
+/**
+  * @brief  Send a windowed write response (ACK/NACK + next expected SEQ)
+  * @param  hboot: Pointer to bootloader handle
+  * @param  response: BOOT_ACK or BOOT_NACK
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_SendWindowResponse(BOOT_Handle_t *hboot, uint8_t response)
+{
+    uint8_t buffer[3];
+    
+    buffer[0] = response;
+    buffer[1] = hboot->window_next_seq & 0xFF;
+    buffer[2] = (hboot->window_next_seq >> 8) & 0xFF;
+    
+    return BOOT_SendData(hboot, buffer, 3);
+}
+
+/**
+  * @brief  Handle windowed write command
+  * @param  hboot: Pointer to bootloader handle
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_HandleWriteWindow(BOOT_Handle_t *hboot)
+{
+    static uint8_t packet[BOOT_WINDOW_HEADER_SIZE + BOOT_MAX_DATA_SIZE] __ALIGNED(4);
+    uint16_t seq;
+    uint32_t data_length;
+    uint32_t address;
+    uint16_t crc_calculated = BOOT_CRC16_INIT;
+    uint16_t *crc_fold = (hboot->integrity == BOOT_INTEGRITY_CRC16) ? &crc_calculated : NULL;
+    BOOT_Status_t status;
+    
+    // Receive SEQ, data length and address (10 bytes); the CRC covers the
+    // header too, so a damaged SEQ or address is rejected
+    if (BOOT_ReceiveDataCRC(hboot, packet, BOOT_WINDOW_HEADER_SIZE, BOOT_TIMEOUT_MS, crc_fold) != BOOT_OK)
+    {
+        BOOT_SendWindowResponse(hboot, BOOT_NACK);
+        return BOOT_TIMEOUT;
+    }
+    seq = (uint16_t)packet[0] | ((uint16_t)packet[1] << 8);
+    data_length = (uint32_t)packet[2] | ((uint32_t)packet[3] << 8) | 
+                  ((uint32_t)packet[4] << 16) | ((uint32_t)packet[5] << 24);
+    address = (uint32_t)packet[6] | ((uint32_t)packet[7] << 8) | 
+              ((uint32_t)packet[8] << 16) | ((uint32_t)packet[9] << 24);
+    
+    // Check if data length is valid
+    if (data_length == 0 || data_length > BOOT_MAX_DATA_SIZE)
+    {
+        BOOT_SendWindowResponse(hboot, BOOT_NACK);
+        return BOOT_ERROR;
+    }
+    
+    // Receive data and CRC (2 bytes, or 4 in CRC32 mode)
+    if (BOOT_ReceiveDataCRC(hboot, &packet[BOOT_WINDOW_HEADER_SIZE], data_length, BOOT_TIMEOUT_MS, crc_fold) != BOOT_OK)
+    {
+        BOOT_SendWindowResponse(hboot, BOOT_NACK);
+        return BOOT_TIMEOUT;
+    }
+    
+    status = BOOT_ReceiveChecksum(hboot, packet, BOOT_WINDOW_HEADER_SIZE + data_length, crc_calculated);
+    if (status != BOOT_OK)
+    {
+        BOOT_SendWindowResponse(hboot, BOOT_NACK);
+        return status;
+    }
+    
+    if (seq == 0)
+    {
+        hboot->window_next_seq = 0;
+    }
+    
+    // Out of order (a previous packet was lost): drop until the host rewinds
+    if (seq != hboot->window_next_seq)
+    {
+        BOOT_SendWindowResponse(hboot, BOOT_NACK);
+        return BOOT_ERROR;
+    }
+    
+    // Later packets keep arriving in the RX ring while this one is programmed
+    if (W25Q128_WriteEx(hboot->hflash, address, &packet[BOOT_WINDOW_HEADER_SIZE], data_length, BOOT_WRITE_FLAGS) != W25Q128_OK)
+    {
+        BOOT_SendWindowResponse(hboot, BOOT_NACK);
+        return BOOT_ERROR;
+    }
+    
+    hboot->total_bytes_written += data_length;
+    hboot->window_next_seq++;
+    
+    BOOT_SendWindowResponse(hboot, BOOT_ACK);
     
     return BOOT_OK;
 }
@@ -227,7 +741,7 @@ static BOOT_Status_t BOOT_HandleRead(BOOT_Handle_t *hboot)
               ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
     
     // Allocate buffer for data
-    static uint8_t large_buffer[BOOT_MAX_DATA_SIZE];
+    static uint8_t large_buffer[BOOT_MAX_DATA_SIZE] __ALIGNED(4);
     data_buffer = large_buffer;
     
     // Read data from flash
@@ -247,10 +761,23 @@ static BOOT_Status_t BOOT_HandleRead(BOOT_Handle_t *hboot)
     }
     
     // Calculate and send CRC
-    crc_calculated = BOOT_CalculateCRC16(data_buffer, data_length);
-    buffer[0] = crc_calculated & 0xFF;
-    buffer[1] = (crc_calculated >> 8) & 0xFF;
-    BOOT_SendData(hboot, buffer, 2);
+    if (hboot->integrity == BOOT_INTEGRITY_CRC32)
+    {
+        uint32_t crc32 = BOOT_HardwareCRC32(hboot, data_buffer, data_length);
+        
+        buffer[0] = crc32 & 0xFF;
+        buffer[1] = (crc32 >> 8) & 0xFF;
+        buffer[2] = (crc32 >> 16) & 0xFF;
+        buffer[3] = (crc32 >> 24) & 0xFF;
+        BOOT_SendData(hboot, buffer, 4);
+    }
+    else
+    {
+        crc_calculated = BOOT_CalculateCRC16(data_buffer, data_length);
+        buffer[0] = crc_calculated & 0xFF;
+        buffer[1] = (crc_calculated >> 8) & 0xFF;
+        BOOT_SendData(hboot, buffer, 2);
+    }
     
     hboot->total_bytes_read += data_length;
     
@@ -258,56 +785,333 @@ static BOOT_Status_t BOOT_HandleRead(BOOT_Handle_t *hboot)
 }
 
 /**
-  * @brief  Handle erase sector command
+  * @brief  End the background job
   * @param  hboot: Pointer to bootloader handle
-  * @retval BOOT_Status_t
+  * @param  state: BOOT_JOB_DONE or BOOT_JOB_FAILED
+  * @retval None
   */
-static BOOT_Status_t BOOT_HandleEraseSector(BOOT_Handle_t *hboot)
+static void BOOT_JobFinish(BOOT_Handle_t *hboot, BOOT_JobState_t state)
 {
-    uint8_t buffer[4];
-    uint32_t address;
-    
-    // Receive address (4 bytes)
-    if (BOOT_ReceiveData(hboot, buffer, 4) != BOOT_OK)
-    {
-        BOOT_SendResponse(hboot, BOOT_NACK);
-        return BOOT_TIMEOUT;
-    }
-    address = (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | 
-              ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
-    
-    // Erase sector
-    if (W25Q128_EraseSector(hboot->hflash, address) != W25Q128_OK)
-    {
-        BOOT_SendResponse(hboot, BOOT_NACK);
-        return BOOT_ERROR;
-    }
-    
-    // Send ACK
-    BOOT_SendResponse(hboot, BOOT_ACK);
-    
-    return BOOT_OK;
+    hboot->job_elapsed_ms = HAL_GetTick() - hboot->job_start_tick;
+    hboot->job_step = 0;
+    hboot->job_state = state;
 }
 
 /**
-  * @brief  Handle erase chip command
+  * @brief  Advance the background job without blocking
+  * @note   Starts the next erase step once the previous one has finished.
   * @param  hboot: Pointer to bootloader handle
-  * @retval BOOT_Status_t
+  * @retval None
   */
-static BOOT_Status_t BOOT_HandleEraseChip(BOOT_Handle_t *hboot)
+static void BOOT_JobPoll(BOOT_Handle_t *hboot)
 {
-    // Erase entire chip (this takes a long time!)
-    if (W25Q128_EraseChip(hboot->hflash) != W25Q128_OK)
+    W25Q128_Status_t status;
+    W25Q128_EraseType_t type;
+    uint32_t step;
+    
+    if (hboot->job_state != BOOT_JOB_BUSY)
     {
-        BOOT_SendResponse(hboot, BOOT_NACK);
-        return BOOT_ERROR;
+        return;
     }
     
-    // Send ACK
-    BOOT_SendResponse(hboot, BOOT_ACK);
+    status = W25Q128_ErasePoll(hboot->hflash);
+    if (status == W25Q128_BUSY)
+    {
+        return;
+    }
     
-    return BOOT_OK;
-}
+    if (status != W25Q128_OK)
+    {
+        BOOT_JobFinish(hboot, BOOT_JOB_FAILED);
+        return;
+    }
+    
+    // Previous step finished
+    hboot->job_address += hboot->job_step;
+    hboot->job_step = 0;
+    
+    if (hboot->job_address >= hboot->job_end)
+    {
+        BOOT_JobFinish(hboot, BOOT_JOB_DONE);
+        return;
+    }
+    
+    if (hboot->job_command == BOOT_CMD_ERASE_CHIP)
+    {
+        type = W25Q128_ERASE_CHIP;
+        step = hboot->job_end - hboot->job_address;
+    }
+    else
+    {
+        step = W25Q128_ErasePlan(hboot->hflash, hboot->job_address, hboot->job_end, &type);
+    }
+    
+    if (W25Q128_EraseStart(hboot->hflash, type, hboot->job_address) != W25Q128_OK)
+    {
+        BOOT_JobFinish(hboot, BOOT_JOB_FAILED);
+        return;
+    }
+    
+    hboot->job_step = step;
+}
+
+/**
+  * @brief  Block until the background job has ended
+  * @note   Terminates: every erase step is bounded by its datasheet timeout.
+  * @param  hboot: Pointer to bootloader handle
+  * @retval None
+  */
+static void BOOT_JobWait(BOOT_Handle_t *hboot)
+{
+    while (hboot->job_state == BOOT_JOB_BUSY)
+    {
+        BOOT_JobPoll(hboot);
+    }
+}
+
+/**
+  * @brief  Start a background erase of [start, end)
+  * @param  hboot: Pointer to bootloader handle
+  * @param  command: BOOT_CMD_ERASE_CHIP or BOOT_CMD_ERASE_RANGE
+  * @param  start: Start address (4KB aligned)
+  * @param  end: End address (4KB aligned, exclusive)
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_JobStart(BOOT_Handle_t *hboot, uint8_t command, uint32_t start, uint32_t end)
+{
+    BOOT_JobWait(hboot);
+    
+    hboot->job_command = command;
+    hboot->job_start = start;
+    hboot->job_end = end;
+    hboot->job_address = start;
+    hboot->job_step = 0;
+    hboot->job_start_tick = HAL_GetTick();
+    hboot->job_elapsed_ms = 0;
+    hboot->job_state = BOOT_JOB_BUSY;
+    
+    // Issue the first erase right away
+    BOOT_JobPoll(hboot);
+    
+    if (hboot->job_state == BOOT_JOB_FAILED)
+    {
+        return BOOT_ERROR;
+    }
+    
+    return BOOT_OK;
+}
+
+/**
+  * @brief  Handle erase sector command
+  * @param  hboot: Pointer to bootloader handle
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_HandleEraseSector(BOOT_Handle_t *hboot)
+{
+    uint8_t buffer[4];
+    uint32_t address;
+    
+    // Receive address (4 bytes)
+    if (BOOT_ReceiveData(hboot, buffer, 4) != BOOT_OK)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_TIMEOUT;
+    }
+    address = (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | 
+              ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+    
+    // Erase sector
+    if (W25Q128_EraseSector(hboot->hflash, address) != W25Q128_OK)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_ERROR;
+    }
+    
+    // Send ACK
+    BOOT_SendResponse(hboot, BOOT_ACK);
+    
+    return BOOT_OK;
+}
+
+/**
+  * @brief  Handle erase range command
+  * @note   ACKs once the erase has started, see BOOT_CMD_JOB_STATUS.
+  * @param  hboot: Pointer to bootloader handle
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_HandleEraseRange(BOOT_Handle_t *hboot)
+{
+    uint8_t buffer[8];
+    uint32_t address;
+    uint32_t length;
+    uint32_t start;
+    uint32_t end;
+    
+    // Receive data length and address (8 bytes), as WRITE/READ/VERIFY
+    if (BOOT_ReceiveData(hboot, buffer, 8) != BOOT_OK)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_TIMEOUT;
+    }
+    length = (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | 
+             ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+    address = (uint32_t)buffer[4] | ((uint32_t)buffer[5] << 8) | 
+              ((uint32_t)buffer[6] << 16) | ((uint32_t)buffer[7] << 24);
+    
+    if (length == 0 || address >= hboot->hflash->capacity || length > hboot->hflash->capacity - address)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_ERROR;
+    }
+    
+    // Widen to sector boundaries and erase in the background
+    start = address & ~(uint32_t)(W25Q128_SECTOR_SIZE - 1);
+    end = (address + length + W25Q128_SECTOR_SIZE - 1) & ~(uint32_t)(W25Q128_SECTOR_SIZE - 1);
+    
+    if (BOOT_JobStart(hboot, BOOT_CMD_ERASE_RANGE, start, end) != BOOT_OK)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_ERROR;
+    }
+    
+    // Send ACK
+    BOOT_SendResponse(hboot, BOOT_ACK);
+    
+    return BOOT_OK;
+}
+
+/**
+  * @brief  Handle erase chip command
+  * @note   ACKs once the erase has started, see BOOT_CMD_JOB_STATUS.
+  * @param  hboot: Pointer to bootloader handle
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_HandleEraseChip(BOOT_Handle_t *hboot)
+{
+    // Erase entire chip in the background (this takes a long time!)
+    if (BOOT_JobStart(hboot, BOOT_CMD_ERASE_CHIP, 0, hboot->hflash->capacity) != BOOT_OK)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_ERROR;
+    }
+    
+    // Send ACK
+    BOOT_SendResponse(hboot, BOOT_ACK);
+    
+    return BOOT_OK;
+}
+
+/**
+  * @brief  Handle job status command
+  * @param  hboot: Pointer to bootloader handle
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_HandleJobStatus(BOOT_Handle_t *hboot)
+{
+    uint8_t status[14];
+    uint32_t elapsed;
+    uint32_t done;
+    uint32_t total;
+    
+    BOOT_JobPoll(hboot);
+    
+    if (hboot->job_state == BOOT_JOB_BUSY)
+    {
+        elapsed = HAL_GetTick() - hboot->job_start_tick;
+    }
+    else
+    {
+        elapsed = hboot->job_elapsed_ms;
+    }
+    done = hboot->job_address - hboot->job_start;
+    total = hboot->job_end - hboot->job_start;
+    
+    status[0] = (uint8_t)hboot->job_state;
+    status[1] = hboot->job_command;
+    status[2] = elapsed & 0xFF;
+    status[3] = (elapsed >> 8) & 0xFF;
+    status[4] = (elapsed >> 16) & 0xFF;
+    status[5] = (elapsed >> 24) & 0xFF;
+    status[6] = done & 0xFF;
+    status[7] = (done >> 8) & 0xFF;
+    status[8] = (done >> 16) & 0xFF;
+    status[9] = (done >> 24) & 0xFF;
+    status[10] = total & 0xFF;
+    status[11] = (total >> 8) & 0xFF;
+    status[12] = (total >> 16) & 0xFF;
+    status[13] = (total >> 24) & 0xFF;
+    
+    BOOT_SendResponse(hboot, BOOT_ACK);
+    BOOT_SendData(hboot, status, sizeof(status));
+    
+    return BOOT_OK;
+}
+
+/**
+  * @brief  Store a 32-bit value little endian
+  * @param  buffer: Destination (4 bytes)
+  * @param  value: Value to store
+  * @retval None
+  */
+static void BOOT_PutU32(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = value & 0xFF;
+    buffer[1] = (value >> 8) & 0xFF;
+    buffer[2] = (value >> 16) & 0xFF;
+    buffer[3] = (value >> 24) & 0xFF;
+}
+
+/**
+  * @brief  Handle get stats command
+  * @note   Sends the PROF_xxx statistics one point at a time, see
+  *         BOOT_CMD_GET_STATS in uart_bootloader.h.
+  * @param  hboot: Pointer to bootloader handle
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_HandleGetStats(BOOT_Handle_t *hboot)
+{
+    uint8_t buffer[20 + PROF_BUCKETS * 4];
+    uint8_t flags;
+    uint8_t points = PROF_ENABLED ? PROF_POINT_COUNT : 0;
+    
+    // Receive flags (1 byte)
+    if (BOOT_ReceiveData(hboot, &flags, 1) != BOOT_OK)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_TIMEOUT;
+    }
+    
+    buffer[0] = points;
+    buffer[1] = PROF_BUCKETS;
+    BOOT_PutU32(&buffer[2], HAL_RCC_GetHCLKFreq());
+    
+    BOOT_SendResponse(hboot, BOOT_ACK);
+    BOOT_SendData(hboot, buffer, 6);
+    
+    for (uint8_t point = 0; point < points; point++)
+    {
+        const PROF_Stats_t *stats = PROF_GetStats((PROF_Point_t)point);
+        
+        BOOT_PutU32(&buffer[0], stats->count);
+        BOOT_PutU32(&buffer[4], stats->count ? stats->min : 0);
+        BOOT_PutU32(&buffer[8], stats->max);
+        BOOT_PutU32(&buffer[12], (uint32_t)stats->total);
+        BOOT_PutU32(&buffer[16], (uint32_t)(stats->total >> 32));
+        for (uint8_t bucket = 0; bucket < PROF_BUCKETS; bucket++)
+        {
+            BOOT_PutU32(&buffer[20 + bucket * 4], stats->histogram[bucket]);
+        }
+        
+        BOOT_SendData(hboot, buffer, sizeof(buffer));
+    }
+    
+    if (flags & BOOT_STATS_CLEAR)
+    {
+        PROF_Reset();
+    }
+    
+    return BOOT_OK;
+}
 
 /**
   * @brief  Handle get info command
@@ -341,8 +1145,8 @@ static BOOT_Status_t BOOT_HandleGetInfo(BOOT_Handle_t *hboot)
     info[3] = jedec_id[1];
     info[4] = jedec_id[2];
     
-    // Flash capacity (16MB = 16777216 bytes)
-    uint32_t capacity = W25Q128_TOTAL_SIZE;
+    // Flash capacity (discovered at init)
+    uint32_t capacity = hboot->hflash->capacity;
     info[5] = capacity & 0xFF;
     info[6] = (capacity >> 8) & 0xFF;
     info[7] = (capacity >> 16) & 0xFF;
@@ -367,6 +1171,374 @@ static BOOT_Status_t BOOT_HandleGetInfo(BOOT_Handle_t *hboot)
     return BOOT_OK;
 }
 
+/**
+  * @brief  Compute CRC32 of a flash range
+  * @note   The next chunk is fetched by DMA while the current one is hashed.
+  * @param  hboot: Pointer to bootloader handle
+  * @param  address: Start address
+  * @param  length: Number of bytes
+  * @param  crc: Pointer to store CRC32 value
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_FlashCRC32(BOOT_Handle_t *hboot, uint32_t address, uint32_t length, uint32_t *crc)
+{
+    uint32_t chunk = (length > BOOT_MAX_DATA_SIZE) ? BOOT_MAX_DATA_SIZE : length;
+    uint8_t index = 0;
+    
+    *crc = 0;
+    
+    if (W25Q128_ReadAsync(hboot->hflash, address, boot_stream_buffer[index], chunk, NULL) != W25Q128_OK)
+    {
+        return BOOT_ERROR;
+    }
+    
+    while (length > 0)
+    {
+        uint32_t current = chunk;
+        
+        if (W25Q128_ReadAsyncWait(hboot->hflash, W25Q128_TIMEOUT_MS) != W25Q128_OK)
+        {
+            return BOOT_ERROR;
+        }
+        
+        address += current;
+        length -= current;
+        
+        // Start fetching the next chunk into the other half
+        if (length > 0)
+        {
+            chunk = (length > BOOT_MAX_DATA_SIZE) ? BOOT_MAX_DATA_SIZE : length;
+            if (W25Q128_ReadAsync(hboot->hflash, address, boot_stream_buffer[index ^ 1], chunk, NULL) != W25Q128_OK)
+            {
+                return BOOT_ERROR;
+            }
+        }
+        
+        *crc = BOOT_CalculateCRC32(*crc, boot_stream_buffer[index], current);
+        index ^= 1;
+    }
+    
+    return BOOT_OK;
+}
+
+/**
+  * @brief  Handle verify command
+  * @param  hboot: Pointer to bootloader handle
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_HandleVerify(BOOT_Handle_t *hboot)
+{
+    uint8_t buffer[8];
+    uint32_t data_length;
+    uint32_t address;
+    uint32_t crc;
+    
+    // Receive data length and address (8 bytes)
+    if (BOOT_ReceiveData(hboot, buffer, 8) != BOOT_OK)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_TIMEOUT;
+    }
+    data_length = (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | 
+                  ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+    address = (uint32_t)buffer[4] | ((uint32_t)buffer[5] << 8) | 
+              ((uint32_t)buffer[6] << 16) | ((uint32_t)buffer[7] << 24);
+    
+    // Check range
+    if (data_length == 0 || address >= hboot->hflash->capacity ||
+        data_length > hboot->hflash->capacity - address)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_ERROR;
+    }
+    
+    if (BOOT_FlashCRC32(hboot, address, data_length, &crc) != BOOT_OK)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_ERROR;
+    }
+    
+    buffer[0] = crc & 0xFF;
+    buffer[1] = (crc >> 8) & 0xFF;
+    buffer[2] = (crc >> 16) & 0xFF;
+    buffer[3] = (crc >> 24) & 0xFF;
+    
+    // Send ACK
+    BOOT_SendResponse(hboot, BOOT_ACK);
+    
+    // Send CRC32
+    BOOT_SendData(hboot, buffer, 4);
+    
+    hboot->total_bytes_read += data_length;
+    
+    return BOOT_OK;
+}
+
+/**
+  * @brief  Handle hash sectors command
+  * @param  hboot: Pointer to bootloader handle
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_HandleHashSectors(BOOT_Handle_t *hboot)
+{
+    static uint8_t hashes[BOOT_HASH_MAX_SECTORS * 4];
+    uint8_t buffer[8];
+    uint32_t address;
+    uint32_t length;
+    uint32_t end_address;
+    uint32_t count = 0;
+    
+    // Receive data length and address (8 bytes), as WRITE/READ/VERIFY
+    if (BOOT_ReceiveData(hboot, buffer, 8) != BOOT_OK)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_TIMEOUT;
+    }
+    length = (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | 
+             ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+    address = (uint32_t)buffer[4] | ((uint32_t)buffer[5] << 8) | 
+              ((uint32_t)buffer[6] << 16) | ((uint32_t)buffer[7] << 24);
+    
+    // Check range and sector count
+    if (length == 0 || address >= hboot->hflash->capacity || length > hboot->hflash->capacity - address ||
+        (address + length - 1) / W25Q128_SECTOR_SIZE - address / W25Q128_SECTOR_SIZE >= BOOT_HASH_MAX_SECTORS)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_ERROR;
+    }
+    
+    end_address = address + length;
+    
+    while (address < end_address)
+    {
+        uint32_t sector_end = (address / W25Q128_SECTOR_SIZE + 1) * W25Q128_SECTOR_SIZE;
+        uint32_t crc;
+        
+        if (sector_end > end_address)
+        {
+            sector_end = end_address;
+        }
+        
+        if (BOOT_FlashCRC32(hboot, address, sector_end - address, &crc) != BOOT_OK)
+        {
+            BOOT_SendResponse(hboot, BOOT_NACK);
+            return BOOT_ERROR;
+        }
+        
+        hashes[count * 4] = crc & 0xFF;
+        hashes[count * 4 + 1] = (crc >> 8) & 0xFF;
+        hashes[count * 4 + 2] = (crc >> 16) & 0xFF;
+        hashes[count * 4 + 3] = (crc >> 24) & 0xFF;
+        count++;
+        
+        address = sector_end;
+    }
+    
+    // Send ACK
+    BOOT_SendResponse(hboot, BOOT_ACK);
+    
+    // Send hash list
+    BOOT_SendData(hboot, hashes, count * 4);
+    
+    hboot->total_bytes_read += length;
+    
+    return BOOT_OK;
+}
+
+/**
+  * @brief  Handle sync command (flush pipelined writes)
+  * @param  hboot: Pointer to bootloader handle
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_HandleSync(BOOT_Handle_t *hboot)
+{
+    // Pipelined writes are programmed before the next command is parsed,
+    // so only the deferred error flag needs to be reported here
+    if (hboot->write_error)
+    {
+        hboot->write_error = 0;
+        BOOT_SendWriteNack(hboot, hboot->write_error_address);
+        return BOOT_ERROR;
+    }
+    
+    BOOT_SendResponse(hboot, BOOT_ACK);
+    
+    return BOOT_OK;
+}
+
+/**
+  * @brief  Select oversampling for a baud rate and check the rate error
+  * @param  hboot: Pointer to bootloader handle
+  * @param  baudrate: Requested baud rate
+  * @param  oversampling: Pointer to store UART_OVERSAMPLING_16 or UART_OVERSAMPLING_8
+  * @retval BOOT_OK if the rate can be generated within BOOT_BAUD_MAX_ERROR
+  */
+static BOOT_Status_t BOOT_CheckBaudrate(BOOT_Handle_t *hboot, uint32_t baudrate, uint32_t *oversampling)
+{
+    uint32_t pclk;
+    uint32_t divider;
+    uint32_t actual;
+    uint32_t error;
+    
+    if (baudrate == 0)
+    {
+        return BOOT_ERROR;
+    }
+    
+    if (hboot->huart->Instance == USART1 || hboot->huart->Instance == USART6)
+    {
+        pclk = HAL_RCC_GetPCLK2Freq();
+    }
+    else
+    {
+        pclk = HAL_RCC_GetPCLK1Freq();
+    }
+    
+    // BRR holds pclk / baud in 1/16 (OVER16) or 1/8 (OVER8) steps with USARTDIV >= 1
+    divider = (pclk + baudrate / 2) / baudrate;
+    if (divider >= 16)
+    {
+        *oversampling = UART_OVERSAMPLING_16;
+    }
+    else if (divider >= 8)
+    {
+        *oversampling = UART_OVERSAMPLING_8;
+    }
+    else
+    {
+        return BOOT_ERROR;
+    }
+    
+    actual = pclk / divider;
+    error = (actual > baudrate) ? (actual - baudrate) : (baudrate - actual);
+    if ((uint64_t)error * 1000 > (uint64_t)baudrate * BOOT_BAUD_MAX_ERROR)
+    {
+        return BOOT_ERROR;
+    }
+    
+    return BOOT_OK;
+}
+
+/**
+  * @brief  Reconfigure the UART for a new baud rate and restart reception
+  * @param  hboot: Pointer to bootloader handle
+  * @param  baudrate: New baud rate
+  * @param  oversampling: UART_OVERSAMPLING_16 or UART_OVERSAMPLING_8
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_SetBaudrate(BOOT_Handle_t *hboot, uint32_t baudrate, uint32_t oversampling)
+{
+    HAL_UART_AbortReceive(hboot->huart);
+    
+    hboot->huart->Init.BaudRate = baudrate;
+    hboot->huart->Init.OverSampling = oversampling;
+    if (HAL_UART_Init(hboot->huart) != HAL_OK)
+    {
+        return BOOT_ERROR;
+    }
+    
+    BOOT_StartReceive(hboot);
+    
+    return BOOT_OK;
+}
+
+/**
+  * @brief  Handle set baud rate command
+  * @param  hboot: Pointer to bootloader handle
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_HandleSetBaud(BOOT_Handle_t *hboot)
+{
+    uint8_t buffer[4];
+    uint8_t byte;
+    uint8_t matched = 0;
+    uint32_t baudrate;
+    uint32_t oversampling;
+    uint32_t old_baudrate = hboot->huart->Init.BaudRate;
+    uint32_t old_oversampling = hboot->huart->Init.OverSampling;
+    const uint8_t probe[3] = {BOOT_START_MARKER1, BOOT_START_MARKER2, BOOT_CMD_SET_BAUD};
+    
+    // Receive baud rate (4 bytes)
+    if (BOOT_ReceiveData(hboot, buffer, 4) != BOOT_OK)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_TIMEOUT;
+    }
+    baudrate = (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | 
+               ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+    
+    if (BOOT_CheckBaudrate(hboot, baudrate, &oversampling) != BOOT_OK)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_ERROR;
+    }
+    
+    // ACK at the old rate; HAL_UART_Transmit returns after the stop bit went out
+    BOOT_SendResponse(hboot, BOOT_ACK);
+    
+    if (BOOT_SetBaudrate(hboot, baudrate, oversampling) != BOOT_OK)
+    {
+        BOOT_SetBaudrate(hboot, old_baudrate, old_oversampling);
+        return BOOT_ERROR;
+    }
+    
+    // Look for the probe, skipping glitches produced while both sides switched
+    uint32_t start = HAL_GetTick();
+    while (matched < sizeof(probe))
+    {
+        uint32_t elapsed = HAL_GetTick() - start;
+        
+        if (elapsed >= BOOT_BAUD_PROBE_MS ||
+            BOOT_ReceiveDataTimeout(hboot, &byte, 1, BOOT_BAUD_PROBE_MS - elapsed) != BOOT_OK)
+        {
+            BOOT_SetBaudrate(hboot, old_baudrate, old_oversampling);
+            return BOOT_TIMEOUT;
+        }
+        
+        if (byte == probe[matched])
+        {
+            matched++;
+        }
+        else
+        {
+            matched = (byte == probe[0]) ? 1 : 0;
+        }
+    }
+    
+    BOOT_SendResponse(hboot, BOOT_ACK);
+    
+    return BOOT_OK;
+}
+
+/**
+  * @brief  Handle set integrity command
+  * @param  hboot: Pointer to bootloader handle
+  * @retval BOOT_Status_t
+  */
+static BOOT_Status_t BOOT_HandleSetIntegrity(BOOT_Handle_t *hboot)
+{
+    uint8_t mode;
+    
+    // Receive mode (1 byte)
+    if (BOOT_ReceiveData(hboot, &mode, 1) != BOOT_OK)
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_TIMEOUT;
+    }
+    
+    // CRC32 needs the CRC unit
+    if (mode != BOOT_INTEGRITY_CRC16 && (mode != BOOT_INTEGRITY_CRC32 || hboot->hcrc == NULL))
+    {
+        BOOT_SendResponse(hboot, BOOT_NACK);
+        return BOOT_ERROR;
+    }
+    
+    hboot->integrity = (BOOT_Integrity_t)mode;
+    BOOT_SendResponse(hboot, BOOT_ACK);
+    
+    return BOOT_OK;
+}
+
 /**
   * @brief  Process bootloader protocol
   * @param  hboot: Pointer to bootloader handle
@@ -377,9 +1549,42 @@ void BOOT_Process(BOOT_Handle_t *hboot)
     uint8_t header[3];
     uint8_t command;
     
-    // Wait for start markers
-    if (HAL_UART_Receive(hboot->huart, header, 2, HAL_MAX_DELAY) != HAL_OK)
+    // Wait for start markers (an idle link in a negotiated rate or integrity
+    // mode falls back to the power-on rate and CRC16)
+    if (hboot->job_state == BOOT_JOB_BUSY)
     {
+        // Keep the background erase moving until the host talks to us
+        BOOT_JobPoll(hboot);
+        
+        if (BOOT_ReceiveDataTimeout(hboot, header, 1, 1) != BOOT_OK)
+        {
+            return;
+        }
+        
+        if (BOOT_ReceiveData(hboot, &header[1], 1) != BOOT_OK)
+        {
+            return;
+        }
+    }
+    else if (hboot->huart->Init.BaudRate == hboot->default_baudrate &&
+             hboot->integrity == BOOT_INTEGRITY_CRC16)
+    {
+        if (BOOT_ReceiveDataTimeout(hboot, header, 2, HAL_MAX_DELAY) != BOOT_OK)
+        {
+            return;
+        }
+    }
+    else if (BOOT_ReceiveDataTimeout(hboot, header, 2, BOOT_BAUD_IDLE_MS) != BOOT_OK)
+    {
+        uint32_t oversampling;
+        
+        hboot->integrity = BOOT_INTEGRITY_CRC16;
+        
+        if (hboot->huart->Init.BaudRate != hboot->default_baudrate &&
+            BOOT_CheckBaudrate(hboot, hboot->default_baudrate, &oversampling) == BOOT_OK)
+        {
+            BOOT_SetBaudrate(hboot, hboot->default_baudrate, oversampling);
+        }
         return;
     }
     
@@ -396,6 +1601,13 @@ void BOOT_Process(BOOT_Handle_t *hboot)
         return;
     }
     
+    // Flash commands need the background erase to be finished
+    if (command != BOOT_CMD_JOB_STATUS && command != BOOT_CMD_SYNC && command != BOOT_CMD_SET_BAUD &&
+        command != BOOT_CMD_GET_STATS && command != BOOT_CMD_SET_INTEGRITY)
+    {
+        BOOT_JobWait(hboot);
+    }
+    
     // Process command
     switch (command)
     {
@@ -415,10 +1627,46 @@ void BOOT_Process(BOOT_Handle_t *hboot)
             BOOT_HandleEraseChip(hboot);
             break;
             
+        case BOOT_CMD_ERASE_RANGE:
+            BOOT_HandleEraseRange(hboot);
+            break;
+            
+        case BOOT_CMD_HASH_SECTORS:
+            BOOT_HandleHashSectors(hboot);
+            break;
+            
         case BOOT_CMD_GET_INFO:
             BOOT_HandleGetInfo(hboot);
             break;
             
+        case BOOT_CMD_VERIFY:
+            BOOT_HandleVerify(hboot);
+            break;
+            
+        case BOOT_CMD_SYNC:
+            BOOT_HandleSync(hboot);
+            break;
+            
+        case BOOT_CMD_WRITE_WINDOW:
+            BOOT_HandleWriteWindow(hboot);
+            break;
+            
+        case BOOT_CMD_SET_BAUD:
+            BOOT_HandleSetBaud(hboot);
+            break;
+            
+        case BOOT_CMD_JOB_STATUS:
+            BOOT_HandleJobStatus(hboot);
+            break;
+            
+        case BOOT_CMD_GET_STATS:
+            BOOT_HandleGetStats(hboot);
+            break;
+            
+        case BOOT_CMD_SET_INTEGRITY:
+            BOOT_HandleSetIntegrity(hboot);
+            break;
+            
         default:
             BOOT_SendResponse(hboot, BOOT_NACK);
             break;
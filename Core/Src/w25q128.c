@@ -8,13 +8,390 @@
 /* USER CODE END Header */
 
 #include "w25q128.h"
+#include <string.h>
 
 /* Private helper macros */
+#if W25Q128_USE_LL_TRANSPORT
+#define CS_LOW()   (hflash->cs_port->BSRR = (uint32_t)hflash->cs_pin << 16U)
+#define CS_HIGH()  (hflash->cs_port->BSRR = hflash->cs_pin)
+#else
 #define CS_LOW()   HAL_GPIO_WritePin(hflash->cs_port, hflash->cs_pin, GPIO_PIN_RESET)
 #define CS_HIGH()  HAL_GPIO_WritePin(hflash->cs_port, hflash->cs_pin, GPIO_PIN_SET)
+#endif
+
+/* Every initialised handle, so SPI callbacks can find their chip */
+static W25Q128_Handle_t *w25q128_handles[W25Q128_MAX_HANDLES];
+static uint8_t w25q128_handle_count = 0;
+
+/**
+  * @brief  Select the SPI clock for the next transfer
+  * @note   Only touches CR1 when the rate changes; called with CS high and
+  *         the bus idle.
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  prescaler: SPI_BAUDRATEPRESCALER_x
+  * @retval None
+  */
+static void W25Q128_SetPrescaler(W25Q128_Handle_t *hflash, uint32_t prescaler)
+{
+    SPI_TypeDef *spi = hflash->hspi->Instance;
+    
+    if ((spi->CR1 & SPI_CR1_BR) != prescaler)
+    {
+        MODIFY_REG(spi->CR1, SPI_CR1_BR, prescaler);
+        hflash->hspi->Init.BaudRatePrescaler = prescaler;
+    }
+}
+
+/**
+  * @brief  Clock a short command/address/status phase (CS already low)
+  * @note   With W25Q128_USE_LL_TRANSPORT the bytes go straight through the
+  *         SPI DR/SR registers, skipping the HAL per-call state handling.
+  *         Bulk data phases keep using the HAL (and DMA).
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  tx: Bytes to send, or NULL to send 0xFF
+  * @param  rx: Buffer for the received bytes, or NULL to discard them
+  * @param  length: Number of bytes
+  * @retval W25Q128_Status_t
+  */
+static W25Q128_Status_t W25Q128_SPI_Exchange(W25Q128_Handle_t *hflash, const uint8_t *tx, uint8_t *rx, uint16_t length)
+{
+#if W25Q128_USE_LL_TRANSPORT
+    SPI_TypeDef *spi = hflash->hspi->Instance;
+    uint32_t spin;
+    uint8_t data;
+    
+    // The HAL enables the peripheral on its first transfer; we may come first
+    if ((spi->CR1 & SPI_CR1_SPE) == 0)
+    {
+        spi->CR1 |= SPI_CR1_SPE;
+    }
+    
+    // Drop a stale byte so every RXNE below belongs to our own write
+    if (spi->SR & SPI_SR_RXNE)
+    {
+        data = *(__IO uint8_t *)&spi->DR;
+    }
+    
+    while (length > 0)
+    {
+        spin = W25Q128_LL_SPIN_LIMIT;
+        while ((spi->SR & SPI_SR_TXE) == 0)
+        {
+            if (--spin == 0)
+            {
+                return W25Q128_ERROR;
+            }
+        }
+        
+        *(__IO uint8_t *)&spi->DR = (tx != NULL) ? *tx++ : 0xFF;
+        
+        spin = W25Q128_LL_SPIN_LIMIT;
+        while ((spi->SR & SPI_SR_RXNE) == 0)
+        {
+            if (--spin == 0)
+            {
+                return W25Q128_ERROR;
+            }
+        }
+        
+        data = *(__IO uint8_t *)&spi->DR;
+        if (rx != NULL)
+        {
+            *rx++ = data;
+        }
+        length--;
+    }
+    
+    // Last byte fully shifted out before CS may rise
+    spin = W25Q128_LL_SPIN_LIMIT;
+    while (spi->SR & SPI_SR_BSY)
+    {
+        if (--spin == 0)
+        {
+            return W25Q128_ERROR;
+        }
+    }
+    
+    return W25Q128_OK;
+#else
+    HAL_StatusTypeDef status;
+    
+    if (tx != NULL && rx != NULL)
+    {
+        status = HAL_SPI_TransmitReceive(hflash->hspi, (uint8_t *)tx, rx, length, W25Q128_TIMEOUT_MS);
+    }
+    else if (tx != NULL)
+    {
+        status = HAL_SPI_Transmit(hflash->hspi, (uint8_t *)tx, length, W25Q128_TIMEOUT_MS);
+    }
+    else
+    {
+        status = HAL_SPI_Receive(hflash->hspi, rx, length, W25Q128_TIMEOUT_MS);
+    }
+    
+    return (status == HAL_OK) ? W25Q128_OK : W25Q128_ERROR;
+#endif
+}
+
+/**
+  * @brief  Run a complete short command: CS low, command, response, CS high
+  * @note   Refused while a DMA read holds CS low on this handle; toggling CS
+  *         or writing the SPI registers would cut that read short.
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  cmd: Command (and address) bytes
+  * @param  cmd_length: Number of command bytes
+  * @param  response: Buffer for the response, may be NULL if response_length is 0
+  * @param  response_length: Number of response bytes
+  * @retval W25Q128_Status_t
+  */
+static W25Q128_Status_t W25Q128_Command(W25Q128_Handle_t *hflash, const uint8_t *cmd, uint16_t cmd_length, uint8_t *response, uint16_t response_length)
+{
+    W25Q128_Status_t status;
+    
+    if (hflash->async_busy)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    W25Q128_SetPrescaler(hflash, hflash->cmd_prescaler);
+    
+    CS_LOW();
+    
+    status = W25Q128_SPI_Exchange(hflash, cmd, NULL, cmd_length);
+    
+    if (status == W25Q128_OK && response_length > 0)
+    {
+        status = W25Q128_SPI_Exchange(hflash, NULL, response, response_length);
+    }
+    
+    CS_HIGH();
+    
+    return status;
+}
+
+/**
+  * @brief  Build opcode + address (+ dummy) bytes for an address phase
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  opcode: Command opcode
+  * @param  address: Flash address
+  * @param  dummy: Number of dummy bytes to append
+  * @param  cmd: Output buffer (W25Q128_MAX_COMMAND_SIZE bytes)
+  * @retval Number of bytes in cmd
+  */
+static uint16_t W25Q128_BuildCommand(W25Q128_Handle_t *hflash, uint8_t opcode, uint32_t address, uint8_t dummy, uint8_t *cmd)
+{
+    uint16_t length = 0;
+    
+    cmd[length++] = opcode;
+    if (hflash->address_bytes == 4)
+    {
+        cmd[length++] = (address >> 24) & 0xFF;
+    }
+    cmd[length++] = (address >> 16) & 0xFF;
+    cmd[length++] = (address >> 8) & 0xFF;
+    cmd[length++] = address & 0xFF;
+    
+    while (dummy > 0)
+    {
+        cmd[length++] = 0xFF;
+        dummy--;
+    }
+    
+    return length;
+}
+
+/**
+  * @brief  Load the W25Q128 datasheet geometry (used when SFDP is missing)
+  * @param  hflash: Pointer to W25Q128 handle
+  * @retval None
+  */
+static void W25Q128_SetDefaultGeometry(W25Q128_Handle_t *hflash)
+{
+    hflash->sfdp_valid = 0;
+    hflash->capacity = W25Q128_TOTAL_SIZE;
+    hflash->address_bytes = 3;
+    hflash->read_opcode = W25Q128_CMD_READ_DATA;
+    hflash->read_dummy = 0;
+    hflash->program_opcode = W25Q128_CMD_PAGE_PROGRAM;
+    
+    hflash->erase_opcode[W25Q128_ERASE_SECTOR_4KB] = W25Q128_CMD_SECTOR_ERASE_4KB;
+    hflash->erase_typ_ms[W25Q128_ERASE_SECTOR_4KB] = W25Q128_TYPICAL_SECTOR_ERASE_MS;
+    hflash->erase_max_ms[W25Q128_ERASE_SECTOR_4KB] = W25Q128_TIMEOUT_SECTOR_ERASE_MS;
+    
+    hflash->erase_opcode[W25Q128_ERASE_BLOCK_32KB] = W25Q128_CMD_BLOCK_ERASE_32KB;
+    hflash->erase_typ_ms[W25Q128_ERASE_BLOCK_32KB] = W25Q128_TYPICAL_BLOCK_ERASE_32KB_MS;
+    hflash->erase_max_ms[W25Q128_ERASE_BLOCK_32KB] = W25Q128_TIMEOUT_BLOCK_ERASE_32KB_MS;
+    
+    hflash->erase_opcode[W25Q128_ERASE_BLOCK_64KB] = W25Q128_CMD_BLOCK_ERASE_64KB;
+    hflash->erase_typ_ms[W25Q128_ERASE_BLOCK_64KB] = W25Q128_TYPICAL_BLOCK_ERASE_64KB_MS;
+    hflash->erase_max_ms[W25Q128_ERASE_BLOCK_64KB] = W25Q128_TIMEOUT_BLOCK_ERASE_64KB_MS;
+    
+    hflash->erase_opcode[W25Q128_ERASE_CHIP] = W25Q128_CMD_CHIP_ERASE;
+    hflash->erase_typ_ms[W25Q128_ERASE_CHIP] = W25Q128_TYPICAL_CHIP_ERASE_MS;
+    hflash->erase_max_ms[W25Q128_ERASE_CHIP] = W25Q128_TIMEOUT_CHIP_ERASE_MS;
+}
+
+/**
+  * @brief  Apply the Basic Flash Parameter Table (JESD216) to the handle
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  bfpt: BFPT DWORDs (bfpt[0] is DWORD 1)
+  * @param  dwords: Number of valid DWORDs (at least 9)
+  * @retval None
+  */
+static void W25Q128_ParseBFPT(W25Q128_Handle_t *hflash, const uint32_t *bfpt, uint8_t dwords)
+{
+    static const uint16_t erase_units_ms[4] = {1, 16, 128, 1000};
+    static const uint32_t chip_units_ms[4] = {16, 256, 4000, 64000};
+    uint32_t multiplier = 0;
+    uint8_t i;
+    
+    // DWORD 2: density in bits, or 2^N bits when bit 31 is set
+    if (bfpt[1] & 0x80000000UL)
+    {
+        uint32_t n = bfpt[1] & 0x7FFFFFFFUL;
+        if (n >= 3 && n <= 34)
+        {
+            hflash->capacity = 1UL << (n - 3);
+        }
+    }
+    else
+    {
+        hflash->capacity = (bfpt[1] >> 3) + 1;
+    }
+    
+    // DWORD 10: maximum time = 2 * (multiplier + 1) * typical time
+    if (dwords >= 10)
+    {
+        multiplier = bfpt[9] & 0x0F;
+    }
+    
+    // DWORDs 8-9: up to four erase types as (log2 size, opcode) pairs
+    hflash->erase_opcode[W25Q128_ERASE_SECTOR_4KB] = 0;
+    hflash->erase_opcode[W25Q128_ERASE_BLOCK_32KB] = 0;
+    hflash->erase_opcode[W25Q128_ERASE_BLOCK_64KB] = 0;
+    
+    for (i = 0; i < 4; i++)
+    {
+        uint32_t entry = bfpt[7 + i / 2] >> ((i % 2) * 16);
+        uint8_t size_log2 = entry & 0xFF;
+        uint8_t opcode = (entry >> 8) & 0xFF;
+        W25Q128_EraseType_t type;
+        
+        if (size_log2 == 12)
+        {
+            type = W25Q128_ERASE_SECTOR_4KB;
+        }
+        else if (size_log2 == 15)
+        {
+            type = W25Q128_ERASE_BLOCK_32KB;
+        }
+        else if (size_log2 == 16)
+        {
+            type = W25Q128_ERASE_BLOCK_64KB;
+        }
+        else
+        {
+            continue;
+        }
+        
+        hflash->erase_opcode[type] = opcode;
+        
+        // DWORD 10: per type 5 bit count and 2 bit unit, starting at bit 4
+        if (dwords >= 10)
+        {
+            uint32_t field = bfpt[9] >> (4 + i * 7);
+            uint32_t typical = ((field & 0x1F) + 1) * erase_units_ms[(field >> 5) & 0x03];
+            
+            hflash->erase_typ_ms[type] = typical;
+            hflash->erase_max_ms[type] = 2 * (multiplier + 1) * typical;
+        }
+    }
+    
+    // The 4KB sector is the driver's smallest erase unit
+    if (hflash->erase_opcode[W25Q128_ERASE_SECTOR_4KB] == 0)
+    {
+        hflash->erase_opcode[W25Q128_ERASE_SECTOR_4KB] = W25Q128_CMD_SECTOR_ERASE_4KB;
+    }
+    
+    // DWORD 11: chip erase typical time, 5 bit count and 2 bit unit at bit 24
+    if (dwords >= 11)
+    {
+        uint32_t field = bfpt[10] >> 24;
+        uint32_t typical = ((field & 0x1F) + 1) * chip_units_ms[(field >> 5) & 0x03];
+        
+        hflash->erase_typ_ms[W25Q128_ERASE_CHIP] = typical;
+        hflash->erase_max_ms[W25Q128_ERASE_CHIP] = 2 * (multiplier + 1) * typical;
+    }
+    
+    // Every SFDP part supports FAST READ (0x0B) with 8 dummy clocks
+    hflash->read_opcode = W25Q128_CMD_FAST_READ;
+    hflash->read_dummy = 1;
+}
+
+/**
+  * @brief  Switch to the 4-byte address command set on parts above 16MB
+  * @note   The dedicated 4-byte opcodes are used instead of entering 4-byte
+  *         address mode (0xB7), so a reset of the MCU alone can never leave
+  *         the flash in a mode the driver does not expect. There is no
+  *         4-byte 32KB block erase, so that type is disabled.
+  * @param  hflash: Pointer to W25Q128 handle
+  * @retval None
+  */
+static void W25Q128_SetAddressMode(W25Q128_Handle_t *hflash)
+{
+    if (hflash->capacity <= W25Q128_3BYTE_ADDRESS_LIMIT)
+    {
+        hflash->address_bytes = 3;
+        return;
+    }
+    
+    hflash->address_bytes = 4;
+    hflash->read_opcode = (hflash->read_opcode == W25Q128_CMD_FAST_READ) ?
+                          W25Q128_CMD_FAST_READ_4B : W25Q128_CMD_READ_DATA_4B;
+    hflash->program_opcode = W25Q128_CMD_PAGE_PROGRAM_4B;
+    hflash->erase_opcode[W25Q128_ERASE_SECTOR_4KB] = W25Q128_CMD_SECTOR_ERASE_4KB_4B;
+    hflash->erase_opcode[W25Q128_ERASE_BLOCK_32KB] = 0;
+    if (hflash->erase_opcode[W25Q128_ERASE_BLOCK_64KB] != 0)
+    {
+        hflash->erase_opcode[W25Q128_ERASE_BLOCK_64KB] = W25Q128_CMD_BLOCK_ERASE_64KB_4B;
+    }
+}
+
+/**
+  * @brief  Smallest SPI prescaler that keeps SCK at or below hz
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  hz: Highest allowed SCK frequency
+  * @retval SPI_BAUDRATEPRESCALER_x
+  */
+static uint32_t W25Q128_PrescalerFor(W25Q128_Handle_t *hflash, uint32_t hz)
+{
+    uint32_t pclk;
+    uint32_t br = 0;
+    
+    // SPI1/4/5 hang off APB2, SPI2/3 off APB1
+    if (hflash->hspi->Instance == SPI2 || hflash->hspi->Instance == SPI3)
+    {
+        pclk = HAL_RCC_GetPCLK1Freq();
+    }
+    else
+    {
+        pclk = HAL_RCC_GetPCLK2Freq();
+    }
+    
+    // BR = n divides by 2^(n+1)
+    while (br < 7 && (pclk >> (br + 1)) > hz)
+    {
+        br++;
+    }
+    
+    return br << SPI_CR1_BR_Pos;
+}
 
 /**
   * @brief  Initialize W25Q128 Flash
+  * @note   The handle is registered for W25Q128_FindHandle; beyond
+  *         W25Q128_MAX_HANDLES handles, DMA reads on the extra ones are
+  *         never completed by the SPI callbacks.
   * @param  hflash: Pointer to W25Q128 handle
   * @param  hspi: Pointer to SPI handle
   * @param  cs_port: Chip select GPIO port
@@ -23,15 +400,181 @@
   */
 void W25Q128_Init(W25Q128_Handle_t *hflash, SPI_HandleTypeDef *hspi, GPIO_TypeDef *cs_port, uint16_t cs_pin)
 {
+    uint8_t i;
+    
+    // Register once, a handle may be initialised again
+    for (i = 0; i < w25q128_handle_count; i++)
+    {
+        if (w25q128_handles[i] == hflash)
+        {
+            break;
+        }
+    }
+    if (i == w25q128_handle_count && w25q128_handle_count < W25Q128_MAX_HANDLES)
+    {
+        w25q128_handles[w25q128_handle_count++] = hflash;
+    }
+    
     hflash->hspi = hspi;
     hflash->cs_port = cs_port;
     hflash->cs_pin = cs_pin;
+    hflash->async_busy = 0;
+    hflash->async_status = W25Q128_OK;
+    hflash->async_buffer = NULL;
+    hflash->async_remaining = 0;
+    hflash->async_callback = NULL;
+    hflash->async_context = NULL;
+    hflash->program_active = 0;
+    hflash->erase_active = 0;
+    hflash->erase_suspended = 0;
+    hflash->erase_type = W25Q128_ERASE_SECTOR_4KB;
+    hflash->erase_start_tick = 0;
+    hflash->erase_suspend_tick = 0;
+    hflash->erase_resume_tick = 0;
+    hflash->erase_typical_ms = 0;
+    hflash->erase_timeout_ms = 0;
+    
+    hflash->cmd_prescaler = hspi->Init.BaudRatePrescaler;
+    hflash->read_prescaler = hspi->Init.BaudRatePrescaler;
+    W25Q128_SetDefaultGeometry(hflash);
     
     CS_HIGH();
     HAL_Delay(100);
     
     // Wake up from power down mode if needed
     W25Q128_WakeUp(hflash);
+    
+    // Learn capacity, erase types and read command from the part itself
+    W25Q128_Discover(hflash);
+    W25Q128_SetClock(hflash, W25Q128_CMD_CLOCK_HZ, W25Q128_READ_CLOCK_HZ);
+}
+
+/**
+  * @brief  Read the SFDP area
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  address: SFDP address
+  * @param  buffer: Pointer to data buffer
+  * @param  length: Number of bytes to read
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_ReadSFDP(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint16_t length)
+{
+    // SFDP always takes a 3-byte address and 8 dummy clocks
+    uint8_t cmd[5] = {W25Q128_CMD_READ_SFDP, (address >> 16) & 0xFF, (address >> 8) & 0xFF, address & 0xFF, 0xFF};
+    
+    if (hflash->async_busy || hflash->erase_active)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    if (W25Q128_Command(hflash, cmd, sizeof(cmd), buffer, length) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Discover the geometry of the attached part
+  * @note   The JEDEC capacity code gives the size when SFDP is missing;
+  *         otherwise the Basic Flash Parameter Table supplies the density,
+  *         the erase types with their timings and FAST READ support. Parts
+  *         without either keep the W25Q128 defaults.
+  * @param  hflash: Pointer to W25Q128 handle
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_Discover(W25Q128_Handle_t *hflash)
+{
+    uint8_t header[16];
+    uint8_t raw[W25Q128_SFDP_BFPT_DWORDS * 4];
+    uint32_t bfpt[W25Q128_SFDP_BFPT_DWORDS];
+    uint32_t signature;
+    uint32_t table_address;
+    uint8_t dwords;
+    uint8_t i;
+    
+    W25Q128_SetDefaultGeometry(hflash);
+    
+    if (W25Q128_ReadJEDECID(hflash, hflash->jedec_id) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    // Capacity code is log2(bytes) on Winbond parts and their clones
+    if (hflash->jedec_id[2] >= 0x10 && hflash->jedec_id[2] <= 0x1F)
+    {
+        hflash->capacity = 1UL << hflash->jedec_id[2];
+    }
+    W25Q128_SetAddressMode(hflash);
+    
+    // SFDP header followed by the first parameter header
+    if (W25Q128_ReadSFDP(hflash, 0, header, sizeof(header)) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    signature = (uint32_t)header[0] | ((uint32_t)header[1] << 8) |
+                ((uint32_t)header[2] << 16) | ((uint32_t)header[3] << 24);
+    dwords = header[11];
+    table_address = (uint32_t)header[12] | ((uint32_t)header[13] << 8) | ((uint32_t)header[14] << 16);
+    
+    if (signature != W25Q128_SFDP_SIGNATURE || header[8] != W25Q128_SFDP_BFPT_ID || dwords < 9)
+    {
+        return W25Q128_OK;
+    }
+    
+    if (dwords > W25Q128_SFDP_BFPT_DWORDS)
+    {
+        dwords = W25Q128_SFDP_BFPT_DWORDS;
+    }
+    
+    if (W25Q128_ReadSFDP(hflash, table_address, raw, dwords * 4) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    for (i = 0; i < dwords; i++)
+    {
+        bfpt[i] = (uint32_t)raw[i * 4] | ((uint32_t)raw[i * 4 + 1] << 8) |
+                  ((uint32_t)raw[i * 4 + 2] << 16) | ((uint32_t)raw[i * 4 + 3] << 24);
+    }
+    
+    W25Q128_ParseBFPT(hflash, bfpt, dwords);
+    hflash->sfdp_valid = 1;
+    
+    W25Q128_SetAddressMode(hflash);
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Set the SPI clock for command traffic and for bulk reads
+  * @note   Each rate is rounded down to what the SPI prescaler can reach
+  *         from its bus clock. The read rate is also capped by the read
+  *         command in use: READ DATA (0x03) is only specified up to
+  *         W25Q128_READ_DATA_MAX_HZ, FAST READ up to W25Q128_FAST_READ_MAX_HZ.
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  cmd_hz: Clock for commands, status polling and page program
+  * @param  read_hz: Clock for READ DATA / FAST READ transfers
+  * @retval None
+  */
+void W25Q128_SetClock(W25Q128_Handle_t *hflash, uint32_t cmd_hz, uint32_t read_hz)
+{
+    uint32_t read_limit = (hflash->read_dummy > 0) ? W25Q128_FAST_READ_MAX_HZ : W25Q128_READ_DATA_MAX_HZ;
+    
+    if (cmd_hz > W25Q128_FAST_READ_MAX_HZ)
+    {
+        cmd_hz = W25Q128_FAST_READ_MAX_HZ;
+    }
+    
+    if (read_hz > read_limit)
+    {
+        read_hz = read_limit;
+    }
+    
+    hflash->cmd_prescaler = W25Q128_PrescalerFor(hflash, cmd_hz);
+    hflash->read_prescaler = W25Q128_PrescalerFor(hflash, read_hz);
 }
 
 /**
@@ -41,101 +584,964 @@ void W25Q128_Init(W25Q128_Handle_t *hflash, SPI_HandleTypeDef *hspi, GPIO_TypeDe
   * @param  device_id: Pointer to store device ID (should be 0x17 for W25Q128)
   * @retval W25Q128_Status_t
   */
-W25Q128_Status_t W25Q128_ReadID(W25Q128_Handle_t *hflash, uint8_t *manufacturer_id, uint8_t *device_id)
+W25Q128_Status_t W25Q128_ReadID(W25Q128_Handle_t *hflash, uint8_t *manufacturer_id, uint8_t *device_id)
+{
+    uint8_t cmd[4] = {W25Q128_CMD_MANUFACTURER_DEVICE_ID, 0x00, 0x00, 0x00};
+    uint8_t data[2];
+    
+    if (hflash->async_busy)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    if (W25Q128_Command(hflash, cmd, 4, data, 2) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    *manufacturer_id = data[0];
+    *device_id = data[1];
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Read JEDEC ID (Manufacturer, Memory Type, Capacity)
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  jedec_id: Pointer to 3-byte buffer to store JEDEC ID
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_ReadJEDECID(W25Q128_Handle_t *hflash, uint8_t *jedec_id)
+{
+    uint8_t cmd = W25Q128_CMD_JEDEC_ID;
+    
+    if (hflash->async_busy)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    if (W25Q128_Command(hflash, &cmd, 1, jedec_id, 3) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Read Status Register
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  status: Pointer to store status register value
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_ReadStatusRegister(W25Q128_Handle_t *hflash, uint8_t *status)
+{
+    uint8_t cmd = W25Q128_CMD_READ_STATUS_REG1;
+    
+    if (hflash->async_busy)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    if (W25Q128_Command(hflash, &cmd, 1, status, 1) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Read Status Register 2
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  status: Pointer to store status register value
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_ReadStatusRegister2(W25Q128_Handle_t *hflash, uint8_t *status)
+{
+    uint8_t cmd = W25Q128_CMD_READ_STATUS_REG2;
+    
+    if (hflash->async_busy)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    if (W25Q128_Command(hflash, &cmd, 1, status, 1) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Called while the driver waits out the typical time of a program
+  *         or erase operation
+  * @note   Override to run other work, yield to a scheduler or __WFI().
+  * @param  hflash: Pointer to W25Q128 handle
+  * @retval None
+  */
+__weak void W25Q128_IdleHook(W25Q128_Handle_t *hflash)
+{
+    UNUSED(hflash);
+}
+
+/**
+  * @brief  Wait for write operation to complete
+  * @param  hflash: Pointer to W25Q128 handle
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_WaitForWriteEnd(W25Q128_Handle_t *hflash)
+{
+    return W25Q128_WaitForWriteEndTimeout(hflash, 0, W25Q128_TIMEOUT_MS);
+}
+
+/**
+  * @brief  Wait for write operation to complete with datasheet timing
+  * @note   The bus is left alone for typical_ms (W25Q128_IdleHook runs
+  *         meanwhile). After that a single READ STATUS REGISTER-1 is issued
+  *         and the register is clocked out continuously with CS held low
+  *         until BUSY clears, so the end of the operation is seen within a
+  *         byte time.
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  typical_ms: Typical busy time of the operation (W25Q128_TYPICAL_xxx_MS)
+  * @param  timeout_ms: Maximum busy time of the operation (W25Q128_TIMEOUT_xxx_MS)
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_WaitForWriteEndTimeout(W25Q128_Handle_t *hflash, uint32_t typical_ms, uint32_t timeout_ms)
+{
+    uint8_t cmd = W25Q128_CMD_READ_STATUS_REG1;
+    uint8_t status = 0;
+    uint32_t start = HAL_GetTick();
+    W25Q128_Status_t result = W25Q128_OK;
+    
+    if (hflash->async_busy)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    while ((HAL_GetTick() - start) < typical_ms)
+    {
+        W25Q128_IdleHook(hflash);
+    }
+    
+    W25Q128_SetPrescaler(hflash, hflash->cmd_prescaler);
+    
+    PROF_START(spin_start);
+    
+    CS_LOW();
+    
+    if (W25Q128_SPI_Exchange(hflash, &cmd, NULL, 1) != W25Q128_OK)
+    {
+        CS_HIGH();
+        return W25Q128_ERROR;
+    }
+    
+    do
+    {
+        if (W25Q128_SPI_Exchange(hflash, NULL, &status, 1) != W25Q128_OK)
+        {
+            result = W25Q128_ERROR;
+            break;
+        }
+        
+        // One extra tick: the first one may be almost over when we start
+        if ((status & W25Q128_STATUS_BUSY) && (HAL_GetTick() - start) > timeout_ms + 1)
+        {
+            result = W25Q128_TIMEOUT;
+            break;
+        }
+        
+    } while (status & W25Q128_STATUS_BUSY);
+    
+    CS_HIGH();
+    
+    PROF_STOP(PROF_FLASH_WAIT_SPIN, spin_start);
+    
+    return result;
+}
+
+/**
+  * @brief  Enable write operations
+  * @param  hflash: Pointer to W25Q128 handle
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_WriteEnable(W25Q128_Handle_t *hflash)
+{
+    uint8_t cmd = W25Q128_CMD_WRITE_ENABLE;
+    
+    if (hflash->async_busy)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    if (W25Q128_Command(hflash, &cmd, 1, NULL, 0) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Disable write operations
+  * @param  hflash: Pointer to W25Q128 handle
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_WriteDisable(W25Q128_Handle_t *hflash)
+{
+    uint8_t cmd = W25Q128_CMD_WRITE_DISABLE;
+    
+    if (hflash->async_busy)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    if (W25Q128_Command(hflash, &cmd, 1, NULL, 0) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Read data from flash
+  * @note   If an erase started with W25Q128_EraseStart is running, it is
+  *         suspended for the read and resumed afterwards.
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  address: Start address to read from (0 to capacity-1)
+  * @param  buffer: Pointer to data buffer
+  * @param  length: Number of bytes to read
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_Read(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    uint8_t cmd[W25Q128_MAX_COMMAND_SIZE];
+    uint16_t cmd_length;
+    W25Q128_Status_t status = W25Q128_OK;
+    PROF_START(read_start);
+    
+    if (hflash->async_busy)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    if (address >= hflash->capacity || length > hflash->capacity - address)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    if (W25Q128_ProgramWait(hflash) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    // A running erase is suspended for the duration of the read
+    if (hflash->erase_active)
+    {
+        status = W25Q128_EraseSuspend(hflash);
+        if (status != W25Q128_OK)
+        {
+            return status;
+        }
+    }
+    
+    cmd_length = W25Q128_BuildCommand(hflash, hflash->read_opcode, address, hflash->read_dummy, cmd);
+    
+    W25Q128_SetPrescaler(hflash, hflash->read_prescaler);
+    
+    CS_LOW();
+    
+    if (W25Q128_SPI_Exchange(hflash, cmd, NULL, cmd_length) != W25Q128_OK)
+    {
+        status = W25Q128_ERROR;
+    }
+    
+    // HAL_SPI_Receive takes a 16-bit size: continue the same READ DATA
+    // sequence in chunks, CS stays low
+    while (status == W25Q128_OK && length > 0)
+    {
+        uint16_t chunk = (length > W25Q128_DMA_MAX_TRANSFER) ?
+                         W25Q128_DMA_MAX_TRANSFER : (uint16_t)length;
+        
+        if (HAL_SPI_Receive(hflash->hspi, buffer, chunk, W25Q128_TIMEOUT_MS) != HAL_OK)
+        {
+            status = W25Q128_ERROR;
+        }
+        buffer += chunk;
+        length -= chunk;
+    }
+    
+    CS_HIGH();
+    
+    if (hflash->erase_suspended && W25Q128_EraseResume(hflash) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    PROF_STOP(PROF_FLASH_READ, read_start);
+    
+    return status;
+}
+
+/**
+  * @brief  Start a non-blocking read using SPI RX/TX DMA
+  * @note   The command/address phase is sent in blocking mode, the data phase
+  *         runs on DMA. Reads longer than W25Q128_DMA_MAX_TRANSFER are chained
+  *         from the completion interrupt while CS stays asserted. The other
+  *         driver calls return W25Q128_BUSY until the transfer has finished.
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  address: Start address to read from (0 to capacity-1)
+  * @param  buffer: Pointer to data buffer (must stay valid until completion)
+  * @param  length: Number of bytes to read
+  * @param  callback: Completion callback (may be NULL, poll with W25Q128_ReadAsyncStatus)
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_ReadAsync(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length, W25Q128_Callback_t callback)
+{
+    uint8_t cmd[W25Q128_MAX_COMMAND_SIZE];
+    uint16_t cmd_length;
+    uint16_t chunk;
+    
+    if (hflash->async_busy)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    if (length == 0 || address >= hflash->capacity || length > hflash->capacity - address)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    if (W25Q128_ProgramWait(hflash) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    // No DMA linked to the SPI handle: fall back to a blocking read
+    if (hflash->hspi->hdmarx == NULL || hflash->hspi->hdmatx == NULL)
+    {
+        W25Q128_Status_t status = W25Q128_Read(hflash, address, buffer, length);
+        hflash->async_status = status;
+        if (callback != NULL)
+        {
+            callback(hflash, status);
+        }
+        return status;
+    }
+    
+    // A running erase is suspended until the DMA transfer completes
+    if (hflash->erase_active)
+    {
+        W25Q128_Status_t status = W25Q128_EraseSuspend(hflash);
+        if (status != W25Q128_OK)
+        {
+            return status;
+        }
+    }
+    
+    cmd_length = W25Q128_BuildCommand(hflash, hflash->read_opcode, address, hflash->read_dummy, cmd);
+    
+    chunk = (length > W25Q128_DMA_MAX_TRANSFER) ? W25Q128_DMA_MAX_TRANSFER : (uint16_t)length;
+    
+    hflash->async_buffer = buffer + chunk;
+    hflash->async_remaining = length - chunk;
+    hflash->async_callback = callback;
+    hflash->async_status = W25Q128_BUSY;
+    hflash->async_busy = 1;
+    PROF_MARK(hflash->async_start_cycles);
+    
+    W25Q128_SetPrescaler(hflash, hflash->read_prescaler);
+    
+    CS_LOW();
+    
+    if (W25Q128_SPI_Exchange(hflash, cmd, NULL, cmd_length) != W25Q128_OK ||
+        HAL_SPI_Receive_DMA(hflash->hspi, buffer, chunk) != HAL_OK)
+    {
+        CS_HIGH();
+        hflash->async_busy = 0;
+        hflash->async_status = W25Q128_ERROR;
+        W25Q128_EraseResume(hflash);
+        return W25Q128_ERROR;
+    }
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Get the state of the last asynchronous read
+  * @param  hflash: Pointer to W25Q128 handle
+  * @retval W25Q128_BUSY while the transfer runs, otherwise its final status
+  */
+W25Q128_Status_t W25Q128_ReadAsyncStatus(W25Q128_Handle_t *hflash)
+{
+    if (hflash->async_busy)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    return hflash->async_status;
+}
+
+/**
+  * @brief  Wait for the asynchronous read to complete
+  * @note   On timeout the DMA transfer is aborted and CS is released.
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  timeout_ms: Maximum time to wait
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_ReadAsyncWait(W25Q128_Handle_t *hflash, uint32_t timeout_ms)
+{
+    uint32_t start = HAL_GetTick();
+    
+    while (hflash->async_busy)
+    {
+        if ((HAL_GetTick() - start) > timeout_ms)
+        {
+            HAL_SPI_Abort(hflash->hspi);
+            CS_HIGH();
+            hflash->async_busy = 0;
+            hflash->async_status = W25Q128_TIMEOUT;
+            W25Q128_EraseResume(hflash);
+            return W25Q128_TIMEOUT;
+        }
+    }
+    
+    return hflash->async_status;
+}
+
+/**
+  * @brief  Find the handle an SPI callback belongs to
+  * @note   Several chips may share one bus; only one of them can have a DMA
+  *         read in flight, and that is the one returned.
+  * @param  hspi: SPI handle that raised the callback
+  * @retval Handle with a DMA read running on hspi, or NULL
+  */
+W25Q128_Handle_t *W25Q128_FindHandle(SPI_HandleTypeDef *hspi)
+{
+    uint8_t i;
+    
+    for (i = 0; i < w25q128_handle_count; i++)
+    {
+        if (w25q128_handles[i]->hspi == hspi && w25q128_handles[i]->async_busy)
+        {
+            return w25q128_handles[i];
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+  * @brief  Handle SPI DMA receive complete (call from HAL_SPI_RxCpltCallback)
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  hspi: SPI handle that raised the callback
+  * @retval None
+  */
+void W25Q128_SPI_RxCpltCallback(W25Q128_Handle_t *hflash, SPI_HandleTypeDef *hspi)
+{
+    uint16_t chunk;
+    
+    if (hspi != hflash->hspi || !hflash->async_busy)
+    {
+        return;
+    }
+    
+    if (hflash->async_remaining > 0)
+    {
+        chunk = (hflash->async_remaining > W25Q128_DMA_MAX_TRANSFER) ?
+                W25Q128_DMA_MAX_TRANSFER : (uint16_t)hflash->async_remaining;
+        
+        // Continue the same READ DATA sequence, CS stays low
+        if (HAL_SPI_Receive_DMA(hflash->hspi, hflash->async_buffer, chunk) == HAL_OK)
+        {
+            hflash->async_buffer += chunk;
+            hflash->async_remaining -= chunk;
+            return;
+        }
+        
+        hflash->async_status = W25Q128_ERROR;
+    }
+    else
+    {
+        hflash->async_status = W25Q128_OK;
+    }
+    
+    CS_HIGH();
+    hflash->async_busy = 0;
+    PROF_STOP(PROF_FLASH_READ_ASYNC, hflash->async_start_cycles);
+    
+    if (hflash->erase_suspended && W25Q128_EraseResume(hflash) != W25Q128_OK)
+    {
+        hflash->async_status = W25Q128_ERROR;
+    }
+    
+    if (hflash->async_callback != NULL)
+    {
+        hflash->async_callback(hflash, hflash->async_status);
+    }
+}
+
+/**
+  * @brief  Handle SPI DMA error (call from HAL_SPI_ErrorCallback)
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  hspi: SPI handle that raised the callback
+  * @retval None
+  */
+void W25Q128_SPI_ErrorCallback(W25Q128_Handle_t *hflash, SPI_HandleTypeDef *hspi)
+{
+    if (hspi != hflash->hspi || !hflash->async_busy)
+    {
+        return;
+    }
+    
+    CS_HIGH();
+    hflash->async_status = W25Q128_ERROR;
+    hflash->async_busy = 0;
+    PROF_STOP(PROF_FLASH_READ_ASYNC, hflash->async_start_cycles);
+    W25Q128_EraseResume(hflash);
+    
+    if (hflash->async_callback != NULL)
+    {
+        hflash->async_callback(hflash, W25Q128_ERROR);
+    }
+}
+
+/**
+  * @brief  Start programming a page (up to 256 bytes) without waiting
+  * @note   The next Read/ReadAsync/ProgramStart/EraseStart on this handle
+  *         waits for the program to finish first; W25Q128_ProgramPoll checks
+  *         without blocking. Meant for overlapping tPP of several chips.
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  address: Start address to write to
+  * @param  buffer: Pointer to data buffer (may be reused on return)
+  * @param  length: Number of bytes to write (max 256)
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_ProgramStart(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    uint8_t cmd[W25Q128_MAX_COMMAND_SIZE];
+    uint16_t cmd_length;
+    
+    if (hflash->async_busy || hflash->erase_active)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    if (length > W25Q128_PAGE_SIZE || address >= hflash->capacity || length > hflash->capacity - address)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    if (W25Q128_ProgramWait(hflash) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    // Enable write
+    if (W25Q128_WriteEnable(hflash) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    cmd_length = W25Q128_BuildCommand(hflash, hflash->program_opcode, address, 0, cmd);
+    
+    W25Q128_SetPrescaler(hflash, hflash->cmd_prescaler);
+    
+    CS_LOW();
+    
+    if (W25Q128_SPI_Exchange(hflash, cmd, NULL, cmd_length) != W25Q128_OK)
+    {
+        CS_HIGH();
+        return W25Q128_ERROR;
+    }
+    
+    // Page data goes through the HAL
+    if (HAL_SPI_Transmit(hflash->hspi, buffer, length, W25Q128_TIMEOUT_MS) != HAL_OK)
+    {
+        CS_HIGH();
+        return W25Q128_ERROR;
+    }
+    
+    CS_HIGH();
+    
+    hflash->program_active = 1;
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Check whether a started page program has finished
+  * @param  hflash: Pointer to W25Q128 handle
+  * @retval W25Q128_BUSY while programming, W25Q128_OK when done (or none running)
+  */
+W25Q128_Status_t W25Q128_ProgramPoll(W25Q128_Handle_t *hflash)
+{
+    uint8_t status;
+    
+    if (!hflash->program_active)
+    {
+        return W25Q128_OK;
+    }
+    
+    if (W25Q128_ReadStatusRegister(hflash, &status) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    if (status & W25Q128_STATUS_BUSY)
+    {
+        return W25Q128_BUSY;
+    }
+    
+    hflash->program_active = 0;
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Block until a started page program has finished
+  * @param  hflash: Pointer to W25Q128 handle
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_ProgramWait(W25Q128_Handle_t *hflash)
+{
+    W25Q128_Status_t status;
+    
+    if (!hflash->program_active)
+    {
+        return W25Q128_OK;
+    }
+    
+    status = W25Q128_WaitForWriteEndTimeout(hflash, W25Q128_TYPICAL_PAGE_PROGRAM_MS, W25Q128_TIMEOUT_PAGE_PROGRAM_MS);
+    if (status != W25Q128_BUSY)
+    {
+        hflash->program_active = 0;
+    }
+    
+    return status;
+}
+
+/**
+  * @brief  Write a page (up to 256 bytes)
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  address: Start address to write to
+  * @param  buffer: Pointer to data buffer
+  * @param  length: Number of bytes to write (max 256)
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_WritePage(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    PROF_START(write_start);
+    W25Q128_Status_t status = W25Q128_ProgramStart(hflash, address, buffer, length);
+    
+    if (status != W25Q128_OK)
+    {
+        return status;
+    }
+    
+    // Wait for write to complete
+    status = W25Q128_ProgramWait(hflash);
+    
+    PROF_STOP(PROF_FLASH_WRITE_PAGE, write_start);
+    
+    return status;
+}
+
+/**
+  * @brief  Write data to flash (handles multiple pages automatically)
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  address: Start address to write to
+  * @param  buffer: Pointer to data buffer
+  * @param  length: Number of bytes to write
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_Write(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    return W25Q128_WriteEx(hflash, address, buffer, length, 0);
+}
+
+/**
+  * @brief  Write data to flash, optionally skipping pages that need no programming
+  * @note   W25Q128_WRITE_SKIP_BLANK: 0xFF bytes leave NOR cells untouched, so
+  *         all-0xFF pages are skipped and 0xFF runs at both ends of a page are
+  *         trimmed. Always safe.
+  *         W25Q128_WRITE_SKIP_UNCHANGED: each page is read back first and not
+  *         programmed if it already holds the data.
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  address: Start address to write to
+  * @param  buffer: Pointer to data buffer
+  * @param  length: Number of bytes to write
+  * @param  flags: Combination of W25Q128_WRITE_SKIP_* flags
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_WriteEx(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length, uint32_t flags)
+{
+    uint8_t readback[W25Q128_PAGE_SIZE];
+    uint32_t remaining = length;
+    uint32_t page_offset;
+    uint32_t write_length;
+    uint32_t current_address = address;
+    uint8_t *current_buffer = buffer;
+    
+    if (address >= hflash->capacity || length > hflash->capacity - address)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    while (remaining > 0)
+    {
+        uint32_t program_start = 0;
+        uint32_t program_end;
+        
+        page_offset = current_address % W25Q128_PAGE_SIZE;
+        write_length = W25Q128_PAGE_SIZE - page_offset;
+        
+        if (write_length > remaining)
+        {
+            write_length = remaining;
+        }
+        
+        program_end = write_length;
+        
+        if (flags & W25Q128_WRITE_SKIP_BLANK)
+        {
+            while (program_start < program_end && current_buffer[program_start] == 0xFF)
+            {
+                program_start++;
+            }
+            while (program_end > program_start && current_buffer[program_end - 1] == 0xFF)
+            {
+                program_end--;
+            }
+        }
+        
+        if (program_start < program_end && (flags & W25Q128_WRITE_SKIP_UNCHANGED))
+        {
+            if (W25Q128_Read(hflash, current_address + program_start, readback, program_end - program_start) != W25Q128_OK)
+            {
+                return W25Q128_ERROR;
+            }
+            
+            if (memcmp(readback, &current_buffer[program_start], program_end - program_start) == 0)
+            {
+                program_end = program_start;
+            }
+        }
+        
+        if (program_start < program_end)
+        {
+            if (W25Q128_WritePage(hflash, current_address + program_start, &current_buffer[program_start],
+                                  program_end - program_start) != W25Q128_OK)
+            {
+                return W25Q128_ERROR;
+            }
+        }
+        
+        current_address += write_length;
+        current_buffer += write_length;
+        remaining -= write_length;
+    }
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Start an erase and return without waiting for it to finish
+  * @note   While the erase runs, W25Q128_Read/W25Q128_ReadAsync suspend it,
+  *         read and resume it. Program and other erase calls return
+  *         W25Q128_BUSY. Completion is detected by W25Q128_ErasePoll or
+  *         W25Q128_EraseWait.
+  * @param  hflash: Pointer to W25Q128 handle
+  * @param  type: Erase granularity
+  * @param  address: Address within the sector/block to erase (ignored for chip erase)
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q128_EraseStart(W25Q128_Handle_t *hflash, W25Q128_EraseType_t type, uint32_t address)
 {
-    uint8_t cmd[4] = {W25Q128_CMD_MANUFACTURER_DEVICE_ID, 0x00, 0x00, 0x00};
-    uint8_t data[2];
+    uint8_t cmd[W25Q128_MAX_COMMAND_SIZE];
+    uint16_t cmd_length;
     
-    CS_LOW();
+    if (hflash->async_busy || hflash->erase_active)
+    {
+        return W25Q128_BUSY;
+    }
     
-    if (HAL_SPI_Transmit(hflash->hspi, cmd, 4, W25Q128_TIMEOUT_MS) != HAL_OK)
+    // Erase types the part does not have (per SFDP) are rejected
+    if (type >= W25Q128_ERASE_TYPE_COUNT || hflash->erase_opcode[type] == 0)
     {
-        CS_HIGH();
         return W25Q128_ERROR;
     }
     
-    if (HAL_SPI_Receive(hflash->hspi, data, 2, W25Q128_TIMEOUT_MS) != HAL_OK)
+    if (type != W25Q128_ERASE_CHIP && address >= hflash->capacity)
     {
-        CS_HIGH();
         return W25Q128_ERROR;
     }
     
-    CS_HIGH();
+    if (W25Q128_ProgramWait(hflash) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
     
-    *manufacturer_id = data[0];
-    *device_id = data[1];
+    cmd_length = W25Q128_BuildCommand(hflash, hflash->erase_opcode[type], address, 0, cmd);
+    if (type == W25Q128_ERASE_CHIP)
+    {
+        cmd_length = 1;
+    }
+    
+    // Enable write
+    if (W25Q128_WriteEnable(hflash) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    if (W25Q128_Command(hflash, cmd, cmd_length, NULL, 0) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    hflash->erase_active = 1;
+    hflash->erase_suspended = 0;
+    hflash->erase_type = type;
+    hflash->erase_typical_ms = hflash->erase_typ_ms[type];
+    hflash->erase_timeout_ms = hflash->erase_max_ms[type];
+    hflash->erase_start_tick = HAL_GetTick();
+    hflash->erase_resume_tick = hflash->erase_start_tick;
+    PROF_MARK(hflash->erase_start_cycles);
     
     return W25Q128_OK;
 }
 
 /**
-  * @brief  Read JEDEC ID (Manufacturer, Memory Type, Capacity)
+  * @brief  Check whether a started erase has finished
+  * @note   Time spent suspended does not count towards the erase timeout.
   * @param  hflash: Pointer to W25Q128 handle
-  * @param  jedec_id: Pointer to 3-byte buffer to store JEDEC ID
-  * @retval W25Q128_Status_t
+  * @retval W25Q128_BUSY while erasing, W25Q128_OK when done (or none running),
+  *         W25Q128_TIMEOUT once the datasheet maximum erase time is exceeded
   */
-W25Q128_Status_t W25Q128_ReadJEDECID(W25Q128_Handle_t *hflash, uint8_t *jedec_id)
+W25Q128_Status_t W25Q128_ErasePoll(W25Q128_Handle_t *hflash)
 {
-    uint8_t cmd = W25Q128_CMD_JEDEC_ID;
+    uint8_t status;
     
-    CS_LOW();
+    if (!hflash->erase_active)
+    {
+        return W25Q128_OK;
+    }
     
-    if (HAL_SPI_Transmit(hflash->hspi, &cmd, 1, W25Q128_TIMEOUT_MS) != HAL_OK)
+    if (hflash->erase_suspended)
     {
-        CS_HIGH();
-        return W25Q128_ERROR;
+        return W25Q128_BUSY;
     }
     
-    if (HAL_SPI_Receive(hflash->hspi, jedec_id, 3, W25Q128_TIMEOUT_MS) != HAL_OK)
+    if (W25Q128_ReadStatusRegister(hflash, &status) != W25Q128_OK)
     {
-        CS_HIGH();
         return W25Q128_ERROR;
     }
     
-    CS_HIGH();
+    if (status & W25Q128_STATUS_BUSY)
+    {
+        if ((HAL_GetTick() - hflash->erase_start_tick) > hflash->erase_timeout_ms + 1)
+        {
+            hflash->erase_active = 0;
+            return W25Q128_TIMEOUT;
+        }
+        return W25Q128_BUSY;
+    }
+    
+    hflash->erase_active = 0;
+    PROF_STOP((PROF_Point_t)(PROF_FLASH_ERASE_4KB + hflash->erase_type), hflash->erase_start_cycles);
     
     return W25Q128_OK;
 }
 
 /**
-  * @brief  Read Status Register
+  * @brief  Block until a started erase has finished
   * @param  hflash: Pointer to W25Q128 handle
-  * @param  status: Pointer to store status register value
   * @retval W25Q128_Status_t
   */
-W25Q128_Status_t W25Q128_ReadStatusRegister(W25Q128_Handle_t *hflash, uint8_t *status)
+W25Q128_Status_t W25Q128_EraseWait(W25Q128_Handle_t *hflash)
 {
-    uint8_t cmd = W25Q128_CMD_READ_STATUS_REG1;
+    W25Q128_Status_t status;
+    uint32_t elapsed;
     
-    CS_LOW();
+    if (!hflash->erase_active)
+    {
+        return W25Q128_OK;
+    }
     
-    if (HAL_SPI_Transmit(hflash->hspi, &cmd, 1, W25Q128_TIMEOUT_MS) != HAL_OK)
+    if (hflash->erase_suspended && W25Q128_EraseResume(hflash) != W25Q128_OK)
     {
-        CS_HIGH();
         return W25Q128_ERROR;
     }
     
-    if (HAL_SPI_Receive(hflash->hspi, status, 1, W25Q128_TIMEOUT_MS) != HAL_OK)
+    // Sleep through the typical erase time and poll only for the rest
+    elapsed = HAL_GetTick() - hflash->erase_start_tick;
+    if (elapsed > hflash->erase_timeout_ms)
     {
-        CS_HIGH();
-        return W25Q128_ERROR;
+        elapsed = hflash->erase_timeout_ms;
     }
     
-    CS_HIGH();
+    status = W25Q128_WaitForWriteEndTimeout(hflash,
+                                            (elapsed < hflash->erase_typical_ms) ? hflash->erase_typical_ms - elapsed : 0,
+                                            hflash->erase_timeout_ms - elapsed);
+    if (status != W25Q128_BUSY)
+    {
+        hflash->erase_active = 0;
+    }
+    if (status == W25Q128_OK)
+    {
+        PROF_STOP((PROF_Point_t)(PROF_FLASH_ERASE_4KB + hflash->erase_type), hflash->erase_start_cycles);
+    }
     
-    return W25Q128_OK;
+    return status;
 }
 
 /**
-  * @brief  Wait for write operation to complete
+  * @brief  Suspend a running erase so the array can be read
+  * @note   To guarantee the erase makes progress, a new suspend is delayed
+  *         until W25Q128_SUSPEND_INTERVAL_MS after the last resume.
   * @param  hflash: Pointer to W25Q128 handle
-  * @retval W25Q128_Status_t
+  * @retval W25Q128_OK when suspended or when the erase has already finished,
+  *         W25Q128_BUSY for a chip erase (the device cannot suspend it)
   */
-W25Q128_Status_t W25Q128_WaitForWriteEnd(W25Q128_Handle_t *hflash)
+W25Q128_Status_t W25Q128_EraseSuspend(W25Q128_Handle_t *hflash)
 {
-    uint8_t status = 0;
-    uint32_t timeout = HAL_GetTick() + 5000;  // 5 second timeout for erase operations
+    uint8_t cmd = W25Q128_CMD_ERASE_SUSPEND;
+    uint8_t status;
+    uint32_t start;
+    
+    if (!hflash->erase_active || hflash->erase_suspended)
+    {
+        return W25Q128_OK;
+    }
+    
+    if (hflash->erase_type == W25Q128_ERASE_CHIP)
+    {
+        return (W25Q128_ErasePoll(hflash) == W25Q128_OK) ? W25Q128_OK : W25Q128_BUSY;
+    }
+    
+    while ((HAL_GetTick() - hflash->erase_resume_tick) < W25Q128_SUSPEND_INTERVAL_MS)
+    {
+        if (W25Q128_ErasePoll(hflash) != W25Q128_BUSY)
+        {
+            return W25Q128_OK;
+        }
+    }
+    
+    // Finished already: nothing to suspend
+    if (W25Q128_ErasePoll(hflash) != W25Q128_BUSY)
+    {
+        return W25Q128_OK;
+    }
     
+    if (W25Q128_Command(hflash, &cmd, 1, NULL, 0) != W25Q128_OK)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    // BUSY clears within tSUS (20us) once the erase is suspended
+    start = HAL_GetTick();
     do
     {
         if (W25Q128_ReadStatusRegister(hflash, &status) != W25Q128_OK)
@@ -143,251 +1549,190 @@ W25Q128_Status_t W25Q128_WaitForWriteEnd(W25Q128_Handle_t *hflash)
             return W25Q128_ERROR;
         }
         
-        if (HAL_GetTick() > timeout)
+        if ((HAL_GetTick() - start) > W25Q128_TIMEOUT_MS)
         {
             return W25Q128_TIMEOUT;
         }
-        
     } while (status & W25Q128_STATUS_BUSY);
     
-    return W25Q128_OK;
-}
-
-/**
-  * @brief  Enable write operations
-  * @param  hflash: Pointer to W25Q128 handle
-  * @retval W25Q128_Status_t
-  */
-W25Q128_Status_t W25Q128_WriteEnable(W25Q128_Handle_t *hflash)
-{
-    uint8_t cmd = W25Q128_CMD_WRITE_ENABLE;
-    
-    CS_LOW();
-    
-    if (HAL_SPI_Transmit(hflash->hspi, &cmd, 1, W25Q128_TIMEOUT_MS) != HAL_OK)
+    // SUS is only set if the erase was still running when the suspend arrived
+    if (W25Q128_ReadStatusRegister2(hflash, &status) != W25Q128_OK)
     {
-        CS_HIGH();
         return W25Q128_ERROR;
     }
     
-    CS_HIGH();
+    if (status & W25Q128_STATUS2_SUS)
+    {
+        hflash->erase_suspended = 1;
+        hflash->erase_suspend_tick = HAL_GetTick();
+    }
+    else
+    {
+        hflash->erase_active = 0;
+    }
     
     return W25Q128_OK;
 }
 
 /**
-  * @brief  Disable write operations
+  * @brief  Resume a suspended erase
   * @param  hflash: Pointer to W25Q128 handle
   * @retval W25Q128_Status_t
   */
-W25Q128_Status_t W25Q128_WriteDisable(W25Q128_Handle_t *hflash)
+W25Q128_Status_t W25Q128_EraseResume(W25Q128_Handle_t *hflash)
 {
-    uint8_t cmd = W25Q128_CMD_WRITE_DISABLE;
+    uint8_t cmd = W25Q128_CMD_ERASE_RESUME;
     
-    CS_LOW();
+    if (!hflash->erase_suspended)
+    {
+        return W25Q128_OK;
+    }
     
-    if (HAL_SPI_Transmit(hflash->hspi, &cmd, 1, W25Q128_TIMEOUT_MS) != HAL_OK)
+    if (W25Q128_Command(hflash, &cmd, 1, NULL, 0) != W25Q128_OK)
     {
-        CS_HIGH();
         return W25Q128_ERROR;
     }
     
-    CS_HIGH();
+    hflash->erase_suspended = 0;
+    hflash->erase_resume_tick = HAL_GetTick();
+    hflash->erase_start_tick += hflash->erase_resume_tick - hflash->erase_suspend_tick;
     
     return W25Q128_OK;
 }
 
 /**
-  * @brief  Read data from flash
+  * @brief  Erase a 4KB sector
   * @param  hflash: Pointer to W25Q128 handle
-  * @param  address: Start address to read from (0 to 16MB-1)
-  * @param  buffer: Pointer to data buffer
-  * @param  length: Number of bytes to read
+  * @param  sector_address: Address within the sector to erase
   * @retval W25Q128_Status_t
   */
-W25Q128_Status_t W25Q128_Read(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length)
+W25Q128_Status_t W25Q128_EraseSector(W25Q128_Handle_t *hflash, uint32_t sector_address)
 {
-    uint8_t cmd[4];
-    
-    cmd[0] = W25Q128_CMD_READ_DATA;
-    cmd[1] = (address >> 16) & 0xFF;
-    cmd[2] = (address >> 8) & 0xFF;
-    cmd[3] = address & 0xFF;
-    
-    CS_LOW();
-    
-    if (HAL_SPI_Transmit(hflash->hspi, cmd, 4, W25Q128_TIMEOUT_MS) != HAL_OK)
-    {
-        CS_HIGH();
-        return W25Q128_ERROR;
-    }
+    W25Q128_Status_t status = W25Q128_EraseStart(hflash, W25Q128_ERASE_SECTOR_4KB, sector_address);
     
-    if (HAL_SPI_Receive(hflash->hspi, buffer, length, W25Q128_TIMEOUT_MS) != HAL_OK)
+    if (status != W25Q128_OK)
     {
-        CS_HIGH();
-        return W25Q128_ERROR;
+        return status;
     }
     
-    CS_HIGH();
-    
-    return W25Q128_OK;
+    // Wait for erase to complete
+    return W25Q128_EraseWait(hflash);
 }
 
 /**
-  * @brief  Write a page (up to 256 bytes)
+  * @brief  Erase a 32KB block
   * @param  hflash: Pointer to W25Q128 handle
-  * @param  address: Start address to write to
-  * @param  buffer: Pointer to data buffer
-  * @param  length: Number of bytes to write (max 256)
+  * @param  block_address: Address within the block to erase
   * @retval W25Q128_Status_t
   */
-W25Q128_Status_t W25Q128_WritePage(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length)
+W25Q128_Status_t W25Q128_EraseBlock32KB(W25Q128_Handle_t *hflash, uint32_t block_address)
 {
-    uint8_t cmd[4];
-    
-    if (length > W25Q128_PAGE_SIZE)
-    {
-        return W25Q128_ERROR;
-    }
+    W25Q128_Status_t status = W25Q128_EraseStart(hflash, W25Q128_ERASE_BLOCK_32KB, block_address);
     
-    // Enable write
-    if (W25Q128_WriteEnable(hflash) != W25Q128_OK)
-    {
-        return W25Q128_ERROR;
-    }
-    
-    cmd[0] = W25Q128_CMD_PAGE_PROGRAM;
-    cmd[1] = (address >> 16) & 0xFF;
-    cmd[2] = (address >> 8) & 0xFF;
-    cmd[3] = address & 0xFF;
-    
-    CS_LOW();
-    
-    if (HAL_SPI_Transmit(hflash->hspi, cmd, 4, W25Q128_TIMEOUT_MS) != HAL_OK)
-    {
-        CS_HIGH();
-        return W25Q128_ERROR;
-    }
-    
-    if (HAL_SPI_Transmit(hflash->hspi, buffer, length, W25Q128_TIMEOUT_MS) != HAL_OK)
+    if (status != W25Q128_OK)
     {
-        CS_HIGH();
-        return W25Q128_ERROR;
+        return status;
     }
     
-    CS_HIGH();
-    
-    // Wait for write to complete
-    return W25Q128_WaitForWriteEnd(hflash);
+    // Wait for erase to complete
+    return W25Q128_EraseWait(hflash);
 }
 
 /**
-  * @brief  Write data to flash (handles multiple pages automatically)
+  * @brief  Erase a 64KB block
   * @param  hflash: Pointer to W25Q128 handle
-  * @param  address: Start address to write to
-  * @param  buffer: Pointer to data buffer
-  * @param  length: Number of bytes to write
+  * @param  block_address: Address within the block to erase
   * @retval W25Q128_Status_t
   */
-W25Q128_Status_t W25Q128_Write(W25Q128_Handle_t *hflash, uint32_t address, uint8_t *buffer, uint32_t length)
+W25Q128_Status_t W25Q128_EraseBlock64KB(W25Q128_Handle_t *hflash, uint32_t block_address)
 {
-    uint32_t remaining = length;
-    uint32_t page_offset;
-    uint32_t write_length;
-    uint32_t current_address = address;
-    uint8_t *current_buffer = buffer;
+    W25Q128_Status_t status = W25Q128_EraseStart(hflash, W25Q128_ERASE_BLOCK_64KB, block_address);
     
-    while (remaining > 0)
+    if (status != W25Q128_OK)
     {
-        page_offset = current_address % W25Q128_PAGE_SIZE;
-        write_length = W25Q128_PAGE_SIZE - page_offset;
-        
-        if (write_length > remaining)
-        {
-            write_length = remaining;
-        }
-        
-        if (W25Q128_WritePage(hflash, current_address, current_buffer, write_length) != W25Q128_OK)
-        {
-            return W25Q128_ERROR;
-        }
-        
-        current_address += write_length;
-        current_buffer += write_length;
-        remaining -= write_length;
+        return status;
     }
     
-    return W25Q128_OK;
+    // Wait for erase to complete
+    return W25Q128_EraseWait(hflash);
 }
 
 /**
-  * @brief  Erase a 4KB sector
-  * @param  hflash: Pointer to W25Q128 handle
-  * @param  sector_address: Address within the sector to erase
-  * @retval W25Q128_Status_t
+  * @brief  Pick the next erase step for a sector aligned range
+  * @note   Uses the largest aligned erase (64KB, 32KB, 4KB) that fits in what
+  *         is left; a 64KB block erase takes a fraction of the time of 16
+  *         sector erases.
+  * @param  hflash: Pointer to W25Q128 handle (for the supported erase types)
+  * @param  address: Next address to erase (4KB aligned)
+  * @param  end_address: End of the range (4KB aligned, exclusive)
+  * @param  type: Receives the erase type to use at address
+  * @retval Number of bytes the step erases
   */
-W25Q128_Status_t W25Q128_EraseSector(W25Q128_Handle_t *hflash, uint32_t sector_address)
+uint32_t W25Q128_ErasePlan(W25Q128_Handle_t *hflash, uint32_t address, uint32_t end_address, W25Q128_EraseType_t *type)
 {
-    uint8_t cmd[4];
+    uint32_t remaining = end_address - address;
     
-    // Enable write
-    if (W25Q128_WriteEnable(hflash) != W25Q128_OK)
+    if (hflash->erase_opcode[W25Q128_ERASE_BLOCK_64KB] != 0 &&
+        (address % W25Q128_BLOCK_SIZE_64KB) == 0 && remaining >= W25Q128_BLOCK_SIZE_64KB)
     {
-        return W25Q128_ERROR;
+        *type = W25Q128_ERASE_BLOCK_64KB;
+        return W25Q128_BLOCK_SIZE_64KB;
     }
     
-    cmd[0] = W25Q128_CMD_SECTOR_ERASE_4KB;
-    cmd[1] = (sector_address >> 16) & 0xFF;
-    cmd[2] = (sector_address >> 8) & 0xFF;
-    cmd[3] = sector_address & 0xFF;
-    
-    CS_LOW();
-    
-    if (HAL_SPI_Transmit(hflash->hspi, cmd, 4, W25Q128_TIMEOUT_MS) != HAL_OK)
+    if (hflash->erase_opcode[W25Q128_ERASE_BLOCK_32KB] != 0 &&
+        (address % W25Q128_BLOCK_SIZE_32KB) == 0 && remaining >= W25Q128_BLOCK_SIZE_32KB)
     {
-        CS_HIGH();
-        return W25Q128_ERROR;
+        *type = W25Q128_ERASE_BLOCK_32KB;
+        return W25Q128_BLOCK_SIZE_32KB;
     }
     
-    CS_HIGH();
-    
-    // Wait for erase to complete
-    return W25Q128_WaitForWriteEnd(hflash);
+    *type = W25Q128_ERASE_SECTOR_4KB;
+    return W25Q128_SECTOR_SIZE;
 }
 
 /**
-  * @brief  Erase a 64KB block
+  * @brief  Erase an address range with the fewest erase operations
+  * @note   The range is widened to 4KB sector boundaries and split by
+  *         W25Q128_ErasePlan.
   * @param  hflash: Pointer to W25Q128 handle
-  * @param  block_address: Address within the block to erase
+  * @param  address: Start address of the range
+  * @param  length: Number of bytes to erase
   * @retval W25Q128_Status_t
   */
-W25Q128_Status_t W25Q128_EraseBlock64KB(W25Q128_Handle_t *hflash, uint32_t block_address)
+W25Q128_Status_t W25Q128_EraseRange(W25Q128_Handle_t *hflash, uint32_t address, uint32_t length)
 {
-    uint8_t cmd[4];
+    uint32_t current_address;
+    uint32_t end_address;
+    W25Q128_EraseType_t type;
+    W25Q128_Status_t status;
     
-    // Enable write
-    if (W25Q128_WriteEnable(hflash) != W25Q128_OK)
+    if (length == 0 || address >= hflash->capacity || length > hflash->capacity - address)
     {
         return W25Q128_ERROR;
     }
     
-    cmd[0] = W25Q128_CMD_BLOCK_ERASE_64KB;
-    cmd[1] = (block_address >> 16) & 0xFF;
-    cmd[2] = (block_address >> 8) & 0xFF;
-    cmd[3] = block_address & 0xFF;
-    
-    CS_LOW();
+    current_address = address & ~(uint32_t)(W25Q128_SECTOR_SIZE - 1);
+    end_address = (address + length + W25Q128_SECTOR_SIZE - 1) & ~(uint32_t)(W25Q128_SECTOR_SIZE - 1);
     
-    if (HAL_SPI_Transmit(hflash->hspi, cmd, 4, W25Q128_TIMEOUT_MS) != HAL_OK)
+    while (current_address < end_address)
     {
-        CS_HIGH();
-        return W25Q128_ERROR;
+        uint32_t erase_size = W25Q128_ErasePlan(hflash, current_address, end_address, &type);
+        
+        status = W25Q128_EraseStart(hflash, type, current_address);
+        if (status == W25Q128_OK)
+        {
+            status = W25Q128_EraseWait(hflash);
+        }
+        
+        if (status != W25Q128_OK)
+        {
+            return status;
+        }
+        
+        current_address += erase_size;
     }
     
-    CS_HIGH();
-    
-    // Wait for erase to complete
-    return W25Q128_WaitForWriteEnd(hflash);
+    return W25Q128_OK;
 }
 
 /**
@@ -397,26 +1742,15 @@ W25Q128_Status_t W25Q128_EraseBlock64KB(W25Q128_Handle_t *hflash, uint32_t block
   */
 W25Q128_Status_t W25Q128_EraseChip(W25Q128_Handle_t *hflash)
 {
-    uint8_t cmd = W25Q128_CMD_CHIP_ERASE;
-    
-    // Enable write
-    if (W25Q128_WriteEnable(hflash) != W25Q128_OK)
-    {
-        return W25Q128_ERROR;
-    }
-    
-    CS_LOW();
+    W25Q128_Status_t status = W25Q128_EraseStart(hflash, W25Q128_ERASE_CHIP, 0);
     
-    if (HAL_SPI_Transmit(hflash->hspi, &cmd, 1, W25Q128_TIMEOUT_MS) != HAL_OK)
+    if (status != W25Q128_OK)
     {
-        CS_HIGH();
-        return W25Q128_ERROR;
+        return status;
     }
     
-    CS_HIGH();
-    
     // Wait for erase to complete (this can take a long time)
-    return W25Q128_WaitForWriteEnd(hflash);
+    return W25Q128_EraseWait(hflash);
 }
 
 /**
@@ -428,16 +1762,16 @@ W25Q128_Status_t W25Q128_PowerDown(W25Q128_Handle_t *hflash)
 {
     uint8_t cmd = W25Q128_CMD_POWER_DOWN;
     
-    CS_LOW();
+    if (hflash->async_busy)
+    {
+        return W25Q128_BUSY;
+    }
     
-    if (HAL_SPI_Transmit(hflash->hspi, &cmd, 1, W25Q128_TIMEOUT_MS) != HAL_OK)
+    if (W25Q128_Command(hflash, &cmd, 1, NULL, 0) != W25Q128_OK)
     {
-        CS_HIGH();
         return W25Q128_ERROR;
     }
     
-    CS_HIGH();
-    
     return W25Q128_OK;
 }
 
@@ -450,16 +1784,16 @@ W25Q128_Status_t W25Q128_WakeUp(W25Q128_Handle_t *hflash)
 {
     uint8_t cmd = W25Q128_CMD_RELEASE_POWER_DOWN;
     
-    CS_LOW();
+    if (hflash->async_busy)
+    {
+        return W25Q128_BUSY;
+    }
     
-    if (HAL_SPI_Transmit(hflash->hspi, &cmd, 1, W25Q128_TIMEOUT_MS) != HAL_OK)
+    if (W25Q128_Command(hflash, &cmd, 1, NULL, 0) != W25Q128_OK)
     {
-        CS_HIGH();
         return W25Q128_ERROR;
     }
     
-    CS_HIGH();
-    
     HAL_Delay(1);  // Wait for device to wake up
     
     return W25Q128_OK;
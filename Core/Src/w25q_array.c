@@ -0,0 +1,350 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : w25q_array.c
+  * @brief          : Striped W25Q flash array Implementation
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#include "w25q_array.h"
+
+/**
+  * @brief  Chip holding a logical address
+  * @param  harray: Pointer to array handle
+  * @param  address: Logical address
+  * @retval Chip index
+  */
+static uint8_t W25Q_ARRAY_Chip(W25Q_ARRAY_Handle_t *harray, uint32_t address)
+{
+    return (address / harray->stripe_size) % harray->count;
+}
+
+/**
+  * @brief  Address inside its chip of a logical address
+  * @param  harray: Pointer to array handle
+  * @param  address: Logical address
+  * @retval Physical address
+  */
+static uint32_t W25Q_ARRAY_Physical(W25Q_ARRAY_Handle_t *harray, uint32_t address)
+{
+    return (address / harray->stripe_size / harray->count) * harray->stripe_size +
+           (address % harray->stripe_size);
+}
+
+/**
+  * @brief  First logical address at or after address that lives on chip
+  * @param  harray: Pointer to array handle
+  * @param  chip: Chip index
+  * @param  address: Logical address
+  * @retval Logical address
+  */
+static uint32_t W25Q_ARRAY_NextOnChip(W25Q_ARRAY_Handle_t *harray, uint8_t chip, uint32_t address)
+{
+    uint32_t stripe = address / harray->stripe_size;
+    uint8_t current = stripe % harray->count;
+    
+    if (current == chip)
+    {
+        return address;
+    }
+    
+    stripe += (chip + harray->count - current) % harray->count;
+    
+    return stripe * harray->stripe_size;
+}
+
+/**
+  * @brief  Initialize a striped array
+  * @param  harray: Pointer to array handle
+  * @param  chips: Initialised chip handles, one per CS line
+  * @param  count: Number of chips (1 to W25Q_ARRAY_MAX_CHIPS)
+  * @param  stripe_size: Interleave unit, power of two and multiple of 4KB
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q_ARRAY_Init(W25Q_ARRAY_Handle_t *harray, W25Q128_Handle_t **chips, uint8_t count, uint32_t stripe_size)
+{
+    uint32_t chip_capacity;
+    uint8_t i;
+    
+    if (count == 0 || count > W25Q_ARRAY_MAX_CHIPS ||
+        stripe_size < W25Q128_SECTOR_SIZE || (stripe_size & (stripe_size - 1)) != 0)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    // The smallest chip sets the usable size of every chip
+    chip_capacity = chips[0]->capacity;
+    for (i = 0; i < count; i++)
+    {
+        harray->chips[i] = chips[i];
+        if (chips[i]->capacity < chip_capacity)
+        {
+            chip_capacity = chips[i]->capacity;
+        }
+    }
+    
+    if (chip_capacity < stripe_size || (chip_capacity % stripe_size) != 0)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    harray->count = count;
+    harray->stripe_size = stripe_size;
+    harray->capacity = chip_capacity * count;
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Read data from the array
+  * @param  harray: Pointer to array handle
+  * @param  address: Logical start address
+  * @param  buffer: Pointer to data buffer
+  * @param  length: Number of bytes to read
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q_ARRAY_Read(W25Q_ARRAY_Handle_t *harray, uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    W25Q128_Status_t status;
+    
+    if (address >= harray->capacity || length > harray->capacity - address)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    while (length > 0)
+    {
+        uint32_t chunk = harray->stripe_size - (address % harray->stripe_size);
+        
+        if (chunk > length)
+        {
+            chunk = length;
+        }
+        
+        status = W25Q128_Read(harray->chips[W25Q_ARRAY_Chip(harray, address)],
+                              W25Q_ARRAY_Physical(harray, address), buffer, chunk);
+        if (status != W25Q128_OK)
+        {
+            return status;
+        }
+        
+        address += chunk;
+        buffer += chunk;
+        length -= chunk;
+    }
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Write data to (erased) array flash
+  * @note   Every chip works through its own part of the range. A chip gets
+  *         its next page as soon as it reports the previous one done, so
+  *         page programs on different chips run at the same time.
+  * @param  harray: Pointer to array handle
+  * @param  address: Logical start address
+  * @param  buffer: Pointer to data buffer
+  * @param  length: Number of bytes to write
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q_ARRAY_Write(W25Q_ARRAY_Handle_t *harray, uint32_t address, uint8_t *buffer, uint32_t length)
+{
+    uint32_t cursor[W25Q_ARRAY_MAX_CHIPS];
+    uint32_t end_address;
+    uint8_t pending;
+    uint8_t i;
+    W25Q128_Status_t status;
+    
+    if (length == 0 || address >= harray->capacity || length > harray->capacity - address)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    end_address = address + length;
+    
+    for (i = 0; i < harray->count; i++)
+    {
+        cursor[i] = W25Q_ARRAY_NextOnChip(harray, i, address);
+    }
+    
+    do
+    {
+        pending = 0;
+        
+        for (i = 0; i < harray->count; i++)
+        {
+            W25Q128_Handle_t *chip = harray->chips[i];
+            uint32_t chunk;
+            
+            if (cursor[i] >= end_address)
+            {
+                continue;
+            }
+            pending = 1;
+            
+            status = W25Q128_ProgramPoll(chip);
+            if (status == W25Q128_BUSY)
+            {
+                continue;
+            }
+            if (status != W25Q128_OK)
+            {
+                return status;
+            }
+            
+            // Up to the end of the page; a page never straddles two stripes
+            chunk = W25Q128_PAGE_SIZE - (cursor[i] % W25Q128_PAGE_SIZE);
+            if (chunk > end_address - cursor[i])
+            {
+                chunk = end_address - cursor[i];
+            }
+            
+            status = W25Q128_ProgramStart(chip, W25Q_ARRAY_Physical(harray, cursor[i]),
+                                          buffer + (cursor[i] - address), chunk);
+            if (status != W25Q128_OK)
+            {
+                return status;
+            }
+            
+            cursor[i] = W25Q_ARRAY_NextOnChip(harray, i, cursor[i] + chunk);
+        }
+    } while (pending);
+    
+    for (i = 0; i < harray->count; i++)
+    {
+        status = W25Q128_ProgramWait(harray->chips[i]);
+        if (status != W25Q128_OK)
+        {
+            return status;
+        }
+    }
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Erase a logical range on all chips at once
+  * @note   The range is widened to 4KB sectors. On each chip it covers one
+  *         contiguous physical range, erased with W25Q128_ErasePlan steps,
+  *         so block erases are used even with a 4KB stripe. The chips
+  *         erase in parallel.
+  * @param  harray: Pointer to array handle
+  * @param  address: Logical start address
+  * @param  length: Number of bytes to erase
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q_ARRAY_EraseRange(W25Q_ARRAY_Handle_t *harray, uint32_t address, uint32_t length)
+{
+    uint32_t physical_start[W25Q_ARRAY_MAX_CHIPS];
+    uint32_t physical_end[W25Q_ARRAY_MAX_CHIPS];
+    uint32_t start_address;
+    uint32_t end_address;
+    uint8_t pending;
+    uint8_t i;
+    W25Q128_Status_t status;
+    
+    if (length == 0 || address >= harray->capacity || length > harray->capacity - address)
+    {
+        return W25Q128_ERROR;
+    }
+    
+    start_address = address & ~(uint32_t)(W25Q128_SECTOR_SIZE - 1);
+    end_address = (address + length + W25Q128_SECTOR_SIZE - 1) & ~(uint32_t)(W25Q128_SECTOR_SIZE - 1);
+    
+    // Physical range of every chip: from its first to its last touched byte
+    for (i = 0; i < harray->count; i++)
+    {
+        uint32_t first = W25Q_ARRAY_NextOnChip(harray, i, start_address);
+        uint32_t last_stripe = (end_address - 1) / harray->stripe_size;
+        uint32_t last_end;
+        
+        last_stripe -= (last_stripe % harray->count + harray->count - i) % harray->count;
+        last_end = (last_stripe + 1) * harray->stripe_size;
+        if (last_end > end_address)
+        {
+            last_end = end_address;
+        }
+        
+        if (first >= end_address || last_end <= first)
+        {
+            physical_start[i] = 0;
+            physical_end[i] = 0;
+            continue;
+        }
+        
+        physical_start[i] = W25Q_ARRAY_Physical(harray, first);
+        physical_end[i] = W25Q_ARRAY_Physical(harray, last_end - 1) + 1;
+    }
+    
+    do
+    {
+        pending = 0;
+        
+        for (i = 0; i < harray->count; i++)
+        {
+            W25Q128_Handle_t *chip = harray->chips[i];
+            W25Q128_EraseType_t type;
+            
+            status = W25Q128_ErasePoll(chip);
+            if (status == W25Q128_BUSY)
+            {
+                pending = 1;
+                continue;
+            }
+            if (status != W25Q128_OK)
+            {
+                return status;
+            }
+            
+            if (physical_start[i] >= physical_end[i])
+            {
+                continue;
+            }
+            
+            uint32_t size = W25Q128_ErasePlan(chip, physical_start[i], physical_end[i], &type);
+            
+            status = W25Q128_EraseStart(chip, type, physical_start[i]);
+            if (status != W25Q128_OK)
+            {
+                return status;
+            }
+            
+            physical_start[i] += size;
+            pending = 1;
+        }
+    } while (pending);
+    
+    return W25Q128_OK;
+}
+
+/**
+  * @brief  Erase every chip of the array (all chip erases run in parallel)
+  * @param  harray: Pointer to array handle
+  * @retval W25Q128_Status_t
+  */
+W25Q128_Status_t W25Q_ARRAY_EraseChip(W25Q_ARRAY_Handle_t *harray)
+{
+    W25Q128_Status_t status;
+    uint8_t i;
+    
+    for (i = 0; i < harray->count; i++)
+    {
+        status = W25Q128_EraseStart(harray->chips[i], W25Q128_ERASE_CHIP, 0);
+        if (status != W25Q128_OK)
+        {
+            return status;
+        }
+    }
+    
+    for (i = 0; i < harray->count; i++)
+    {
+        status = W25Q128_EraseWait(harray->chips[i]);
+        if (status != W25Q128_OK)
+        {
+            return status;
+        }
+    }
+    
+    return W25Q128_OK;
+}
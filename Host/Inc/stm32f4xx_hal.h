@@ -0,0 +1,248 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : stm32f4xx_hal.h
+  * @brief          : Host (Linux) stand-in for the STM32F4 HAL
+  ******************************************************************************
+  * @attention
+  *
+  * Only what the flash driver and the bootloader use, so Core/Src can be
+  * built and run on a PC:
+  * - SPI transfers go to the W25Q model whose CS pin is low (w25q_model.h)
+  * - SPI "DMA" completes after the transfer time at the programmed SCK,
+  *   seen from HAL_GetTick (the host's SysTick)
+  * - USART1 is a pseudo terminal; the circular RX DMA and TX are paced at
+  *   the configured baud rate unless pacing is turned off
+  * - HAL_GetTick runs on CLOCK_MONOTONIC
+  * - DWT->CYCCNT counts HCLK cycles of CLOCK_MONOTONIC time once enabled
+  * - The CRC unit computes CRC-32/MPEG-2 over 32-bit words in software
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#ifndef __STM32F4xx_HAL_H
+#define __STM32F4xx_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define __IO                      volatile
+#define __weak                    __attribute__((weak))
+#define HAL_MAX_DELAY             0xFFFFFFFFU
+#define UNUSED(X)                 (void)(X)
+
+#define SET_BIT(REG, BIT)         ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT)       ((REG) &= ~(BIT))
+#define READ_BIT(REG, BIT)        ((REG) & (BIT))
+#define MODIFY_REG(REG, CLEARMASK, SETMASK) ((REG) = (((REG) & (~(CLEARMASK))) | (SETMASK)))
+
+#define __CLZ(value)              ((value) ? (uint32_t)__builtin_clz(value) : 32U)
+#define __ALIGNED(x)              __attribute__((aligned(x)))
+
+typedef enum {
+    HAL_OK       = 0x00U,
+    HAL_ERROR    = 0x01U,
+    HAL_BUSY     = 0x02U,
+    HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+/* Clocks (SystemClock_Config: 100MHz HCLK, APB1 / 2, APB2 / 1) */
+#define HOST_HCLK_HZ              100000000U
+#define HOST_PCLK1_HZ             50000000U
+#define HOST_PCLK2_HZ             100000000U
+
+/* Core debug: DWT cycle counter. Every access through DWT brings CYCCNT
+   up to date; a value written to it is kept as the new origin. */
+typedef struct {
+    __IO uint32_t CTRL;
+    __IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+    __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+#define DWT_CTRL_CYCCNTENA_Msk    (0x1UL << 0U)
+#define CoreDebug_DEMCR_TRCENA_Msk (0x1UL << 24U)
+
+extern CoreDebug_Type HOST_CoreDebug;
+#define CoreDebug                 (&HOST_CoreDebug)
+#define DWT                       (HOST_DWT())
+
+/* GPIO */
+typedef struct {
+    __IO uint32_t ODR;
+    __IO uint32_t BSRR;
+} GPIO_TypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+#define GPIO_PIN_0                ((uint16_t)0x0001)
+#define GPIO_PIN_1                ((uint16_t)0x0002)
+#define GPIO_PIN_2                ((uint16_t)0x0004)
+#define GPIO_PIN_3                ((uint16_t)0x0008)
+#define GPIO_PIN_4                ((uint16_t)0x0010)
+#define GPIO_PIN_5                ((uint16_t)0x0020)
+#define GPIO_PIN_6                ((uint16_t)0x0040)
+#define GPIO_PIN_7                ((uint16_t)0x0080)
+
+extern GPIO_TypeDef HOST_GPIOA;
+extern GPIO_TypeDef HOST_GPIOB;
+#define GPIOA                     (&HOST_GPIOA)
+#define GPIOB                     (&HOST_GPIOB)
+
+/* DMA */
+typedef struct {
+    __IO uint32_t NDTR;               // Items left, as DMA_SxNDTR
+    void *Parent;
+} DMA_HandleTypeDef;
+
+#define __HAL_DMA_GET_COUNTER(__HANDLE__) HOST_DMA_GetCounter(__HANDLE__)
+
+/* SPI */
+typedef struct {
+    __IO uint32_t CR1;
+    __IO uint32_t SR;
+    __IO uint32_t DR;
+} SPI_TypeDef;
+
+#define SPI_CR1_BR_Pos            (3U)
+#define SPI_CR1_BR                (0x7UL << SPI_CR1_BR_Pos)
+#define SPI_CR1_SPE               (0x1UL << 6U)
+#define SPI_SR_RXNE               (0x1UL << 0U)
+#define SPI_SR_TXE                (0x1UL << 1U)
+#define SPI_SR_BSY                (0x1UL << 7U)
+
+#define SPI_BAUDRATEPRESCALER_2   (0x00000000U)
+#define SPI_BAUDRATEPRESCALER_4   (0x00000008U)
+#define SPI_BAUDRATEPRESCALER_8   (0x00000010U)
+#define SPI_BAUDRATEPRESCALER_16  (0x00000018U)
+#define SPI_BAUDRATEPRESCALER_32  (0x00000020U)
+#define SPI_BAUDRATEPRESCALER_64  (0x00000028U)
+#define SPI_BAUDRATEPRESCALER_128 (0x00000030U)
+#define SPI_BAUDRATEPRESCALER_256 (0x00000038U)
+
+typedef struct {
+    uint32_t BaudRatePrescaler;
+} SPI_InitTypeDef;
+
+typedef struct {
+    SPI_TypeDef *Instance;
+    SPI_InitTypeDef Init;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+} SPI_HandleTypeDef;
+
+extern SPI_TypeDef HOST_SPI1;
+extern SPI_TypeDef HOST_SPI2;
+extern SPI_TypeDef HOST_SPI3;
+#define SPI1                      (&HOST_SPI1)
+#define SPI2                      (&HOST_SPI2)
+#define SPI3                      (&HOST_SPI3)
+
+/* CRC */
+typedef struct {
+    __IO uint32_t DR;
+} CRC_TypeDef;
+
+typedef struct {
+    CRC_TypeDef *Instance;
+} CRC_HandleTypeDef;
+
+extern CRC_TypeDef HOST_CRC;
+#define CRC                       (&HOST_CRC)
+
+/* UART */
+typedef struct {
+    uint32_t reserved;
+} USART_TypeDef;
+
+typedef enum {
+    HAL_UART_STATE_RESET   = 0x00U,
+    HAL_UART_STATE_READY   = 0x20U,
+    HAL_UART_STATE_BUSY_RX = 0x22U
+} HAL_UART_StateTypeDef;
+
+#define UART_WORDLENGTH_8B        0x00000000U
+#define UART_STOPBITS_1           0x00000000U
+#define UART_PARITY_NONE          0x00000000U
+#define UART_MODE_TX_RX           0x0000000CU
+#define UART_HWCONTROL_NONE       0x00000000U
+#define UART_OVERSAMPLING_16      0x00000000U
+#define UART_OVERSAMPLING_8       0x00008000U
+
+typedef struct {
+    uint32_t BaudRate;
+    uint32_t WordLength;
+    uint32_t StopBits;
+    uint32_t Parity;
+    uint32_t Mode;
+    uint32_t HwFlowCtl;
+    uint32_t OverSampling;
+} UART_InitTypeDef;
+
+typedef struct {
+    USART_TypeDef *Instance;
+    UART_InitTypeDef Init;
+    DMA_HandleTypeDef *hdmatx;
+    DMA_HandleTypeDef *hdmarx;
+    __IO HAL_UART_StateTypeDef RxState;
+    uint8_t *pRxBuffPtr;              // Circular DMA target
+    uint16_t RxXferSize;
+} UART_HandleTypeDef;
+
+extern USART_TypeDef HOST_USART1;
+extern USART_TypeDef HOST_USART2;
+extern USART_TypeDef HOST_USART6;
+#define USART1                    (&HOST_USART1)
+#define USART2                    (&HOST_USART2)
+#define USART6                    (&HOST_USART6)
+
+/* HAL */
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, const uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, const uint8_t *pTxData, uint8_t *pRxData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi);
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+
+HAL_StatusTypeDef HAL_CRC_Init(CRC_HandleTypeDef *hcrc);
+uint32_t HAL_CRC_Accumulate(CRC_HandleTypeDef *hcrc, uint32_t pBuffer[], uint32_t BufferLength);
+uint32_t HAL_CRC_Calculate(CRC_HandleTypeDef *hcrc, uint32_t pBuffer[], uint32_t BufferLength);
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart);
+
+uint32_t HAL_RCC_GetHCLKFreq(void);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+uint32_t HAL_RCC_GetPCLK2Freq(void);
+
+/* Host side */
+uint32_t HOST_DMA_GetCounter(DMA_HandleTypeDef *hdma);
+DWT_Type *HOST_DWT(void);
+uint64_t HOST_GetMicros(void);
+int HOST_UART_Open(UART_HandleTypeDef *huart, const char *link_path);
+void HOST_UART_SetPacing(uint8_t enable);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __STM32F4xx_HAL_H */
@@ -0,0 +1,97 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : w25q_model.h
+  * @brief          : Header for the behavioural W25Q128JV model (host build)
+  ******************************************************************************
+  * @attention
+  *
+  * Byte-level model of the SPI side of a W25Q128JV, fed by the host HAL
+  * shim whenever its CS pin is low:
+  * - 16MB array, optionally backed by an image file (kept across runs)
+  * - NOR semantics: program only clears bits, erase sets them back to 1
+  * - BUSY for the datasheet typical tPP/tSE/tBE/tCE, scaled by time_scale
+  * - Erase suspend/resume, power down, JEDEC/manufacturer/unique ID
+  * - SFDP with a Basic Flash Parameter Table matching the timings above
+  *
+  * Instructions other than status reads and erase suspend are ignored
+  * while BUSY, like on the real part.
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#ifndef __W25Q_MODEL_H
+#define __W25Q_MODEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32f4xx_hal.h"
+
+/* Geometry */
+#define W25Q_MODEL_SIZE           (16UL * 1024 * 1024)
+#define W25Q_MODEL_PAGE_SIZE      256
+#define W25Q_MODEL_SFDP_SIZE      256
+#define W25Q_MODEL_MAX_DEVICES    4
+
+/* Datasheet typical times in microseconds */
+#define W25Q_MODEL_TPP_US         400
+#define W25Q_MODEL_TSE_US         45000
+#define W25Q_MODEL_TBE32_US       120000
+#define W25Q_MODEL_TBE64_US       150000
+#define W25Q_MODEL_TCE_US         40000000
+
+/* Model state */
+typedef struct {
+    uint8_t *array;
+    int fd;                           // Image file, -1 when RAM only
+    uint8_t sfdp[W25Q_MODEL_SFDP_SIZE];
+    uint8_t unique_id[8];
+    uint32_t time_scale;              // Percent of the datasheet times
+    
+    /* Wiring */
+    SPI_TypeDef *spi;
+    GPIO_TypeDef *cs_port;
+    uint16_t cs_pin;
+    uint8_t selected;
+    
+    /* Current instruction */
+    uint8_t opcode;
+    uint8_t ignored;                  // Instruction not accepted in this state
+    uint32_t index;                   // Bytes clocked since CS went low
+    uint32_t address;
+    uint8_t page[W25Q_MODEL_PAGE_SIZE];
+    
+    /* Status */
+    uint8_t wel;
+    uint8_t power_down;
+    uint64_t program_until_us;
+    uint8_t erase_active;
+    uint8_t erase_suspended;
+    uint64_t erase_until_us;
+    uint64_t erase_remaining_us;      // While suspended
+    uint32_t erase_address;
+    uint32_t erase_size;
+    
+    /* Counters */
+    uint32_t page_programs;
+    uint32_t erases;
+    uint64_t bytes_read;
+    uint64_t program_busy_us;         // Busy time started by page programs
+    uint64_t erase_busy_us;           // Busy time started by erases
+} W25Q_MODEL_t;
+
+/* Function Prototypes */
+int W25Q_MODEL_Init(W25Q_MODEL_t *model, const char *image_path);
+void W25Q_MODEL_Close(W25Q_MODEL_t *model);
+void W25Q_MODEL_Attach(W25Q_MODEL_t *model, SPI_TypeDef *spi, GPIO_TypeDef *cs_port, uint16_t cs_pin);
+void W25Q_MODEL_SetPin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+uint8_t W25Q_MODEL_Exchange(SPI_TypeDef *spi, uint8_t mosi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __W25Q_MODEL_H */
@@ -0,0 +1,222 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : host_main.c
+  * @brief          : Host build entry point: bootloader on a pseudo terminal
+  ******************************************************************************
+  * @attention
+  *
+  * Runs the same W25Q128 driver and UART bootloader as the firmware, wired
+  * like main.c (SPI1 with DMA, CS on PA4, USART1 with circular RX DMA),
+  * against a simulated W25Q128JV. The bootloader listens on a pseudo
+  * terminal, so tools/flash_upload.py can be pointed at it:
+  *
+  *   flash_host -i flash.img -l /tmp/ttyFLASH
+  *   python3 tools/flash_upload.py -p /tmp/ttyFLASH -f tools/animations.bin -v
+  *
+  * Options:
+  *   -i FILE    keep the flash array in FILE (created erased if missing)
+  *   -l PATH    symlink PATH to the pseudo terminal
+  *   -b BAUD    power-on baud rate (default 115200, as MX_USART1_UART_Init)
+  *   -t PCT     flash busy times in percent of the datasheet (default 100)
+  *   -n         no baud rate pacing, bytes move as fast as the host allows
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#include "stm32f4xx_hal.h"
+#include "w25q_model.h"
+#include "w25q128.h"
+#include "uart_bootloader.h"
+#include "profile.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+SPI_HandleTypeDef hspi1;
+DMA_HandleTypeDef hdma_spi1_rx;
+DMA_HandleTypeDef hdma_spi1_tx;
+UART_HandleTypeDef huart1;
+CRC_HandleTypeDef hcrc;
+DMA_HandleTypeDef hdma_usart1_rx;
+
+W25Q_MODEL_t flash_model;
+W25Q128_Handle_t hflash;
+BOOT_Handle_t hboot;
+
+/**
+  * @brief  Print the flash counters, flush the image and leave on SIGINT/SIGTERM
+  * @note   The STATS line is what tools/bench_upload.py reads back.
+  * @param  signal: Signal number
+  * @retval None
+  */
+static void HOST_Stop(int signal)
+{
+    char line[160];
+    int length;
+    
+    (void)signal;
+    
+    length = snprintf(line, sizeof(line),
+                      "STATS page_programs=%lu erases=%lu bytes_read=%llu program_busy_us=%llu erase_busy_us=%llu\n",
+                      (unsigned long)flash_model.page_programs, (unsigned long)flash_model.erases,
+                      (unsigned long long)flash_model.bytes_read,
+                      (unsigned long long)flash_model.program_busy_us,
+                      (unsigned long long)flash_model.erase_busy_us);
+    if (length > 0 && write(STDOUT_FILENO, line, length) < 0)
+    {
+        length = 0;
+    }
+    
+    W25Q_MODEL_Close(&flash_model);
+    _exit(0);
+}
+
+/**
+  * @brief  SPI1 as MX_SPI1_Init leaves it: 50MHz SCK, RX/TX DMA linked
+  * @retval None
+  */
+static void HOST_SPI1_Init(void)
+{
+    hspi1.Instance = SPI1;
+    hspi1.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_2;
+    hspi1.Instance->CR1 = SPI_BAUDRATEPRESCALER_2;
+    hspi1.hdmarx = &hdma_spi1_rx;
+    hspi1.hdmatx = &hdma_spi1_tx;
+    hdma_spi1_rx.Parent = &hspi1;
+    hdma_spi1_tx.Parent = &hspi1;
+    
+    HAL_GPIO_WritePin(GPIOA, GPIO_PIN_4, GPIO_PIN_SET);
+}
+
+/**
+  * @brief  USART1 as MX_USART1_UART_Init leaves it, RX DMA linked
+  * @param  baudrate: Power-on baud rate
+  * @retval None
+  */
+static void HOST_USART1_Init(uint32_t baudrate)
+{
+    huart1.Instance = USART1;
+    huart1.Init.BaudRate = baudrate;
+    huart1.Init.WordLength = UART_WORDLENGTH_8B;
+    huart1.Init.StopBits = UART_STOPBITS_1;
+    huart1.Init.Parity = UART_PARITY_NONE;
+    huart1.Init.Mode = UART_MODE_TX_RX;
+    huart1.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+    huart1.Init.OverSampling = UART_OVERSAMPLING_16;
+    huart1.hdmarx = &hdma_usart1_rx;
+    hdma_usart1_rx.Parent = &huart1;
+    
+    HAL_UART_Init(&huart1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *image_path = NULL;
+    const char *link_path = NULL;
+    uint32_t baudrate = 115200;
+    uint32_t time_scale = 100;
+    uint8_t pacing = 1;
+    int option;
+    
+    while ((option = getopt(argc, argv, "i:l:b:t:n")) != -1)
+    {
+        switch (option)
+        {
+            case 'i':
+                image_path = optarg;
+                break;
+            case 'l':
+                link_path = optarg;
+                break;
+            case 'b':
+                baudrate = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                time_scale = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                pacing = 0;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-i image] [-l link] [-b baud] [-t percent] [-n]\n", argv[0]);
+                return 1;
+        }
+    }
+    
+    if (W25Q_MODEL_Init(&flash_model, image_path) != 0)
+    {
+        perror("flash image");
+        return 1;
+    }
+    flash_model.time_scale = time_scale;
+    W25Q_MODEL_Attach(&flash_model, SPI1, GPIOA, GPIO_PIN_4);
+    
+    signal(SIGINT, HOST_Stop);
+    signal(SIGTERM, HOST_Stop);
+    
+    HOST_SPI1_Init();
+    HOST_USART1_Init(baudrate);
+    HOST_UART_SetPacing(pacing);
+    
+    if (HOST_UART_Open(&huart1, link_path) != 0)
+    {
+        perror("pseudo terminal");
+        return 1;
+    }
+    
+    // Start the cycle counter (no-op unless built with PROF_ENABLED)
+    PROF_Init();
+    
+    // Initialize W25Q128 Flash
+    W25Q128_Init(&hflash, &hspi1, GPIOA, GPIO_PIN_4);
+    
+    printf("W25Q128: JEDEC %02X %02X %02X, %lu bytes, SFDP %s\n",
+           hflash.jedec_id[0], hflash.jedec_id[1], hflash.jedec_id[2],
+           (unsigned long)hflash.capacity, hflash.sfdp_valid ? "yes" : "no");
+    fflush(stdout);
+    
+    // CRC unit, as MX_CRC_Init
+    hcrc.Instance = CRC;
+    HAL_CRC_Init(&hcrc);
+    
+    // Initialize UART Bootloader
+    BOOT_Init(&hboot, &huart1, &hflash, &hcrc);
+    
+    while (1)
+    {
+        BOOT_Process(&hboot);
+    }
+}
+
+/**
+  * @brief  SPI DMA receive complete, forwarded to the handle reading on hspi
+  * @param  hspi: SPI handle
+  * @retval None
+  */
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    W25Q128_Handle_t *flash = W25Q128_FindHandle(hspi);
+    
+    if (flash != NULL)
+    {
+        W25Q128_SPI_RxCpltCallback(flash, hspi);
+    }
+}
+
+/**
+  * @brief  SPI error, forwarded to the handle reading on hspi
+  * @param  hspi: SPI handle
+  * @retval None
+  */
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    W25Q128_Handle_t *flash = W25Q128_FindHandle(hspi);
+    
+    if (flash != NULL)
+    {
+        W25Q128_SPI_ErrorCallback(flash, hspi);
+    }
+}
@@ -0,0 +1,556 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : stm32f4xx_hal_host.c
+  * @brief          : Host (Linux) stand-in for the STM32F4 HAL Implementation
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#define _GNU_SOURCE
+#include "stm32f4xx_hal.h"
+#include "w25q_model.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// termios.h defines CR1 as a tab delay flag, clashing with SPI_TypeDef.CR1
+#undef CR1
+
+GPIO_TypeDef HOST_GPIOA;
+GPIO_TypeDef HOST_GPIOB;
+SPI_TypeDef HOST_SPI1;
+SPI_TypeDef HOST_SPI2;
+SPI_TypeDef HOST_SPI3;
+USART_TypeDef HOST_USART1;
+USART_TypeDef HOST_USART2;
+USART_TypeDef HOST_USART6;
+CoreDebug_Type HOST_CoreDebug;
+CRC_TypeDef HOST_CRC;
+
+/* SPI receive running "on DMA" */
+static struct {
+    SPI_HandleTypeDef *hspi;
+    uint8_t *data;
+    uint16_t size;
+    uint64_t done_us;
+} spi_dma;
+
+/* Pseudo terminal behind the UART */
+static struct {
+    UART_HandleTypeDef *huart;
+    int master_fd;
+    int slave_fd;
+    uint8_t pacing;
+    uint64_t rx_clock_us;             // Line time used up by received bytes
+    uint64_t tx_clock_us;             // When the last transmitted byte is out
+} uart = {NULL, -1, -1, 1, 0, 0};
+
+static uint8_t in_interrupt;
+
+/* DWT cycle counter */
+static struct {
+    DWT_Type regs;
+    uint32_t shown;                   // CYCCNT as last returned
+    uint64_t origin;                  // Host cycle count where CYCCNT was 0
+} dwt;
+
+/**
+  * @brief  Microseconds since the first call
+  * @retval Time in microseconds
+  */
+uint64_t HOST_GetMicros(void)
+{
+    static uint64_t origin;
+    struct timespec ts;
+    uint64_t now;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    if (origin == 0)
+    {
+        origin = now;
+    }
+    
+    return now - origin;
+}
+
+/**
+  * @brief  DWT registers with CYCCNT brought up to date
+  * @note   CYCCNT only runs while TRCENA and CYCCNTENA are set; if the
+  *         application wrote it since the last access, counting continues
+  *         from the written value.
+  * @retval Pointer to the DWT registers
+  */
+DWT_Type *HOST_DWT(void)
+{
+    struct timespec ts;
+    uint64_t cycles;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    cycles = ((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec) / (1000000000 / HOST_HCLK_HZ);
+    
+    if (dwt.regs.CYCCNT != dwt.shown)
+    {
+        dwt.origin = cycles - dwt.regs.CYCCNT;
+    }
+    
+    if ((HOST_CoreDebug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk) &&
+        (dwt.regs.CTRL & DWT_CTRL_CYCCNTENA_Msk))
+    {
+        dwt.regs.CYCCNT = (uint32_t)(cycles - dwt.origin);
+    }
+    else
+    {
+        dwt.origin = cycles - dwt.regs.CYCCNT;
+    }
+    dwt.shown = dwt.regs.CYCCNT;
+    
+    return &dwt.regs;
+}
+
+/**
+  * @brief  Microseconds needed to move bytes over the UART
+  * @param  bytes: Byte count (10 bits each)
+  * @retval Time in microseconds
+  */
+static uint64_t HOST_UART_LineTime(uint32_t bytes)
+{
+    return (uint64_t)bytes * 10 * 1000000 / uart.huart->Init.BaudRate;
+}
+
+/**
+  * @brief  Complete the SPI DMA transfer once its time has come
+  * @note   Runs the completion callback as the DMA interrupt would.
+  * @retval None
+  */
+static void HOST_ServiceInterrupts(void)
+{
+    SPI_HandleTypeDef *hspi = spi_dma.hspi;
+    uint16_t i;
+    
+    if (in_interrupt || hspi == NULL || HOST_GetMicros() < spi_dma.done_us)
+    {
+        return;
+    }
+    
+    in_interrupt = 1;
+    
+    for (i = 0; i < spi_dma.size; i++)
+    {
+        spi_dma.data[i] = W25Q_MODEL_Exchange(hspi->Instance, 0xFF);
+    }
+    spi_dma.hspi = NULL;
+    hspi->hdmarx->NDTR = 0;
+    
+    HAL_SPI_RxCpltCallback(hspi);
+    
+    in_interrupt = 0;
+}
+
+/**
+  * @brief  Move bytes from the pseudo terminal into the circular RX buffer
+  * @note   With pacing on, no more bytes are delivered than the line could
+  *         have carried at the configured baud rate.
+  * @retval None
+  */
+static void HOST_UART_Pump(void)
+{
+    UART_HandleTypeDef *huart = uart.huart;
+    uint8_t buffer[256];
+    uint64_t now = HOST_GetMicros();
+    uint32_t allowed = sizeof(buffer);
+    ssize_t received;
+    ssize_t i;
+    
+    if (huart == NULL || huart->RxState != HAL_UART_STATE_BUSY_RX || huart->RxXferSize == 0)
+    {
+        return;
+    }
+    
+    if (uart.pacing)
+    {
+        uint64_t credit = (now > uart.rx_clock_us) ? now - uart.rx_clock_us : 0;
+        uint64_t bytes = credit * huart->Init.BaudRate / 10 / 1000000;
+        
+        if (bytes < allowed)
+        {
+            allowed = (uint32_t)bytes;
+        }
+        if (allowed == 0)
+        {
+            return;
+        }
+    }
+    
+    received = read(uart.master_fd, buffer, allowed);
+    if (received <= 0)
+    {
+        // Idle line: data arriving later starts from now
+        uart.rx_clock_us = now;
+        usleep(10);
+        return;
+    }
+    
+    for (i = 0; i < received; i++)
+    {
+        uint32_t head = huart->RxXferSize - huart->hdmarx->NDTR;
+        
+        huart->pRxBuffPtr[head] = buffer[i];
+        huart->hdmarx->NDTR = (huart->hdmarx->NDTR > 1) ? huart->hdmarx->NDTR - 1 : huart->RxXferSize;
+    }
+    
+    uart.rx_clock_us += HOST_UART_LineTime((uint32_t)received);
+}
+
+/**
+  * @brief  Items left in a DMA stream (NDTR)
+  * @param  hdma: DMA handle
+  * @retval Counter value
+  */
+uint32_t HOST_DMA_GetCounter(DMA_HandleTypeDef *hdma)
+{
+    HOST_ServiceInterrupts();
+    
+    if (uart.huart != NULL && hdma == uart.huart->hdmarx)
+    {
+        HOST_UART_Pump();
+    }
+    
+    return hdma->NDTR;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    HOST_ServiceInterrupts();
+    
+    return (uint32_t)(HOST_GetMicros() / 1000);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    uint32_t start = HAL_GetTick();
+    
+    while ((HAL_GetTick() - start) < Delay)
+    {
+        usleep(100);
+    }
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    if (PinState == GPIO_PIN_SET)
+    {
+        GPIOx->ODR |= GPIO_Pin;
+    }
+    else
+    {
+        GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+    }
+    
+    W25Q_MODEL_SetPin(GPIOx, GPIO_Pin, PinState);
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, const uint8_t *pTxData, uint8_t *pRxData, uint16_t Size, uint32_t Timeout)
+{
+    uint16_t i;
+    
+    (void)Timeout;
+    
+    if (spi_dma.hspi == hspi)
+    {
+        return HAL_BUSY;
+    }
+    
+    for (i = 0; i < Size; i++)
+    {
+        uint8_t data = W25Q_MODEL_Exchange(hspi->Instance, (pTxData != NULL) ? pTxData[i] : 0xFF);
+        
+        if (pRxData != NULL)
+        {
+            pRxData[i] = data;
+        }
+    }
+    
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, const uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    return HAL_SPI_TransmitReceive(hspi, pData, NULL, Size, Timeout);
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    return HAL_SPI_TransmitReceive(hspi, NULL, pData, Size, Timeout);
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size)
+{
+    uint32_t divider = 2U << ((hspi->Instance->CR1 & SPI_CR1_BR) >> SPI_CR1_BR_Pos);
+    uint32_t pclk = (hspi->Instance == SPI1) ? HAL_RCC_GetPCLK2Freq() : HAL_RCC_GetPCLK1Freq();
+    
+    if (spi_dma.hspi != NULL || hspi->hdmarx == NULL || Size == 0)
+    {
+        return HAL_BUSY;
+    }
+    
+    spi_dma.hspi = hspi;
+    spi_dma.data = pData;
+    spi_dma.size = Size;
+    spi_dma.done_us = HOST_GetMicros() + (uint64_t)Size * 8 * divider * 1000000 / pclk;
+    hspi->hdmarx->NDTR = Size;
+    
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi)
+{
+    if (spi_dma.hspi == hspi)
+    {
+        spi_dma.hspi = NULL;
+    }
+    
+    return HAL_OK;
+}
+
+__weak void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+}
+
+__weak void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+}
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+    if (huart->Init.BaudRate == 0)
+    {
+        return HAL_ERROR;
+    }
+    
+    huart->RxState = HAL_UART_STATE_READY;
+    uart.rx_clock_us = HOST_GetMicros();
+    
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    uint64_t now = HOST_GetMicros();
+    uint16_t sent = 0;
+    
+    (void)Timeout;
+    
+    if (huart != uart.huart)
+    {
+        return HAL_ERROR;
+    }
+    
+    while (sent < Size)
+    {
+        ssize_t written = write(uart.master_fd, &pData[sent], Size - sent);
+        
+        if (written < 0)
+        {
+            if (errno != EAGAIN)
+            {
+                return HAL_ERROR;
+            }
+            usleep(100);
+            continue;
+        }
+        sent += (uint16_t)written;
+    }
+    
+    // Return once the last stop bit would have left the pin
+    if (uart.pacing)
+    {
+        uart.tx_clock_us = ((uart.tx_clock_us > now) ? uart.tx_clock_us : now) + HOST_UART_LineTime(Size);
+        while (HOST_GetMicros() < uart.tx_clock_us)
+        {
+            HAL_GetTick();
+            usleep(20);
+        }
+    }
+    
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    uint32_t start = HAL_GetTick();
+    uint16_t received = 0;
+    
+    if (huart != uart.huart)
+    {
+        return HAL_ERROR;
+    }
+    
+    while (received < Size)
+    {
+        ssize_t count = read(uart.master_fd, &pData[received], Size - received);
+        
+        if (count > 0)
+        {
+            received += (uint16_t)count;
+            continue;
+        }
+        
+        if (Timeout != HAL_MAX_DELAY && (HAL_GetTick() - start) >= Timeout)
+        {
+            return HAL_TIMEOUT;
+        }
+        usleep(10);
+    }
+    
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    if (huart != uart.huart || huart->hdmarx == NULL || Size == 0)
+    {
+        return HAL_ERROR;
+    }
+    
+    huart->pRxBuffPtr = pData;
+    huart->RxXferSize = Size;
+    huart->hdmarx->NDTR = Size;
+    huart->RxState = HAL_UART_STATE_BUSY_RX;
+    uart.rx_clock_us = HOST_GetMicros();
+    
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart)
+{
+    huart->RxState = HAL_UART_STATE_READY;
+    huart->RxXferSize = 0;
+    
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_CRC_Init(CRC_HandleTypeDef *hcrc)
+{
+    hcrc->Instance->DR = 0xFFFFFFFF;
+    
+    return HAL_OK;
+}
+
+/**
+  * @brief  Feed words to the CRC unit (poly 0x04C11DB7, MSB first, as the
+  *         F4 CRC unit)
+  * @param  hcrc: Pointer to CRC handle
+  * @param  pBuffer: Words to add
+  * @param  BufferLength: Number of words
+  * @retval CRC register
+  */
+uint32_t HAL_CRC_Accumulate(CRC_HandleTypeDef *hcrc, uint32_t pBuffer[], uint32_t BufferLength)
+{
+    uint32_t crc = hcrc->Instance->DR;
+    
+    for (uint32_t i = 0; i < BufferLength; i++)
+    {
+        crc ^= pBuffer[i];
+        for (uint8_t bit = 0; bit < 32; bit++)
+        {
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+        }
+    }
+    hcrc->Instance->DR = crc;
+    
+    return crc;
+}
+
+uint32_t HAL_CRC_Calculate(CRC_HandleTypeDef *hcrc, uint32_t pBuffer[], uint32_t BufferLength)
+{
+    hcrc->Instance->DR = 0xFFFFFFFF;
+    
+    return HAL_CRC_Accumulate(hcrc, pBuffer, BufferLength);
+}
+
+uint32_t HAL_RCC_GetHCLKFreq(void)
+{
+    return HOST_HCLK_HZ;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+    return HOST_PCLK1_HZ;
+}
+
+uint32_t HAL_RCC_GetPCLK2Freq(void)
+{
+    return HOST_PCLK2_HZ;
+}
+
+/**
+  * @brief  Back a UART handle with a new pseudo terminal
+  * @param  huart: UART handle
+  * @param  link_path: Symlink to create to the terminal, or NULL
+  * @retval 0 on success, -1 on error
+  */
+int HOST_UART_Open(UART_HandleTypeDef *huart, const char *link_path)
+{
+    struct termios tio;
+    const char *name;
+    
+    uart.master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (uart.master_fd < 0 || grantpt(uart.master_fd) != 0 || unlockpt(uart.master_fd) != 0)
+    {
+        return -1;
+    }
+    
+    name = ptsname(uart.master_fd);
+    if (name == NULL)
+    {
+        return -1;
+    }
+    
+    // Keep a slave handle open so the master never sees a hang-up, and make the line raw
+    uart.slave_fd = open(name, O_RDWR | O_NOCTTY);
+    if (uart.slave_fd < 0 || tcgetattr(uart.slave_fd, &tio) != 0)
+    {
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(uart.slave_fd, TCSANOW, &tio);
+    
+    fcntl(uart.master_fd, F_SETFL, fcntl(uart.master_fd, F_GETFL) | O_NONBLOCK);
+    
+    if (link_path != NULL)
+    {
+        unlink(link_path);
+        if (symlink(name, link_path) != 0)
+        {
+            return -1;
+        }
+    }
+    
+    uart.huart = huart;
+    huart->RxState = HAL_UART_STATE_READY;
+    
+    printf("UART: %s%s%s\n", name, (link_path != NULL) ? " -> " : "", (link_path != NULL) ? link_path : "");
+    fflush(stdout);
+    
+    return 0;
+}
+
+/**
+  * @brief  Turn baud rate pacing of the pseudo terminal on or off
+  * @param  enable: 1 to pace, 0 to move bytes as fast as the host can
+  * @retval None
+  */
+void HOST_UART_SetPacing(uint8_t enable)
+{
+    uart.pacing = enable;
+}
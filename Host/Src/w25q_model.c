@@ -0,0 +1,579 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : w25q_model.c
+  * @brief          : Behavioural W25Q128JV model Implementation (host build)
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+#include "w25q_model.h"
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Instructions understood by the model */
+#define CMD_WRITE_STATUS_REG      0x01
+#define CMD_PAGE_PROGRAM          0x02
+#define CMD_READ_DATA             0x03
+#define CMD_WRITE_DISABLE         0x04
+#define CMD_READ_STATUS_REG1      0x05
+#define CMD_WRITE_ENABLE          0x06
+#define CMD_FAST_READ             0x0B
+#define CMD_SECTOR_ERASE_4KB      0x20
+#define CMD_READ_STATUS_REG2      0x35
+#define CMD_UNIQUE_ID             0x4B
+#define CMD_BLOCK_ERASE_32KB      0x52
+#define CMD_READ_SFDP             0x5A
+#define CMD_CHIP_ERASE_ALT        0x60
+#define CMD_ERASE_SUSPEND         0x75
+#define CMD_ERASE_RESUME          0x7A
+#define CMD_MANUFACTURER_ID       0x90
+#define CMD_JEDEC_ID              0x9F
+#define CMD_RELEASE_POWER_DOWN    0xAB
+#define CMD_POWER_DOWN            0xB9
+#define CMD_CHIP_ERASE            0xC7
+#define CMD_BLOCK_ERASE_64KB      0xD8
+
+#define SR1_BUSY                  0x01
+#define SR1_WEL                   0x02
+#define SR2_SUS                   0x80
+
+static const uint8_t jedec_id[3] = {0xEF, 0x40, 0x18};
+
+/*
+ * SFDP: header, one parameter header, BFPT (16 DWORDs) at 0x80.
+ * DWORD 10 typical erase times 48/128/160ms (multiplier 6), DWORD 11 chip
+ * erase 40s, page program 448us, 256 byte pages.
+ */
+static const uint32_t bfpt[16] = {
+    0xFFF920E5, 0x07FFFFFF, 0x6B08EB44, 0xBB423B08,
+    0xFFFFFFFE, 0xFF00FFFF, 0xEB40FFFF, 0x520F200C,
+    0xFF00D810, 0x00A53A26, 0x49002683, 0xFFFFFFFF,
+    0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF
+};
+
+static W25Q_MODEL_t *devices[W25Q_MODEL_MAX_DEVICES];
+static uint8_t device_count;
+
+/**
+  * @brief  Scale a datasheet time
+  * @param  model: Pointer to model
+  * @param  us: Typical time in microseconds
+  * @retval Busy time in microseconds
+  */
+static uint64_t W25Q_MODEL_Time(W25Q_MODEL_t *model, uint64_t us)
+{
+    return us * model->time_scale / 100;
+}
+
+/**
+  * @brief  Finish operations whose time is up
+  * @param  model: Pointer to model
+  * @retval None
+  */
+static void W25Q_MODEL_Update(W25Q_MODEL_t *model)
+{
+    uint64_t now = HOST_GetMicros();
+    
+    if (model->erase_active && !model->erase_suspended && now >= model->erase_until_us)
+    {
+        memset(&model->array[model->erase_address], 0xFF, model->erase_size);
+        model->erase_active = 0;
+        model->erases++;
+    }
+}
+
+/**
+  * @brief  Whether a program or a (running) erase is in progress
+  * @param  model: Pointer to model
+  * @retval 1 when BUSY
+  */
+static uint8_t W25Q_MODEL_Busy(W25Q_MODEL_t *model)
+{
+    W25Q_MODEL_Update(model);
+    
+    return (HOST_GetMicros() < model->program_until_us) ||
+           (model->erase_active && !model->erase_suspended);
+}
+
+/**
+  * @brief  Status register 1
+  * @param  model: Pointer to model
+  * @retval Register value
+  */
+static uint8_t W25Q_MODEL_Status1(W25Q_MODEL_t *model)
+{
+    uint8_t busy = W25Q_MODEL_Busy(model);
+    
+    // WEL drops when the operation it enabled has finished
+    if (!busy && model->wel == 2)
+    {
+        model->wel = 0;
+    }
+    
+    return (busy ? SR1_BUSY : 0) | (model->wel ? SR1_WEL : 0);
+}
+
+/**
+  * @brief  Start an erase
+  * @param  model: Pointer to model
+  * @param  size: Erase size in bytes
+  * @param  us: Typical erase time
+  * @retval None
+  */
+static void W25Q_MODEL_StartErase(W25Q_MODEL_t *model, uint32_t size, uint64_t us)
+{
+    model->erase_address = model->address & ~(size - 1) & (W25Q_MODEL_SIZE - 1);
+    model->erase_size = size;
+    model->erase_active = 1;
+    model->erase_suspended = 0;
+    model->erase_until_us = HOST_GetMicros() + W25Q_MODEL_Time(model, us);
+    model->erase_busy_us += W25Q_MODEL_Time(model, us);
+    model->wel = 2;
+}
+
+/**
+  * @brief  CS low: start a new instruction
+  * @param  model: Pointer to model
+  * @retval None
+  */
+static void W25Q_MODEL_Select(W25Q_MODEL_t *model)
+{
+    model->selected = 1;
+    model->index = 0;
+    model->opcode = 0;
+    model->ignored = 0;
+    model->address = 0;
+    memset(model->page, 0xFF, sizeof(model->page));
+}
+
+/**
+  * @brief  CS high: execute instructions that act on the rising edge
+  * @param  model: Pointer to model
+  * @retval None
+  */
+static void W25Q_MODEL_Deselect(W25Q_MODEL_t *model)
+{
+    uint32_t i;
+    
+    model->selected = 0;
+    
+    if (model->index == 0 || model->ignored)
+    {
+        return;
+    }
+    
+    switch (model->opcode)
+    {
+        case CMD_WRITE_ENABLE:
+            model->wel = 1;
+            break;
+            
+        case CMD_WRITE_DISABLE:
+            model->wel = 0;
+            break;
+            
+        case CMD_PAGE_PROGRAM:
+            if (model->wel == 1 && model->index > 4)
+            {
+                uint32_t page = model->address & ~(uint32_t)(W25Q_MODEL_PAGE_SIZE - 1) & (W25Q_MODEL_SIZE - 1);
+                
+                // Bits can only go from 1 to 0
+                for (i = 0; i < W25Q_MODEL_PAGE_SIZE; i++)
+                {
+                    model->array[page + i] &= model->page[i];
+                }
+                model->program_until_us = HOST_GetMicros() + W25Q_MODEL_Time(model, W25Q_MODEL_TPP_US);
+                model->program_busy_us += W25Q_MODEL_Time(model, W25Q_MODEL_TPP_US);
+                model->page_programs++;
+                model->wel = 2;
+            }
+            break;
+            
+        case CMD_SECTOR_ERASE_4KB:
+            if (model->wel == 1 && model->index == 4)
+            {
+                W25Q_MODEL_StartErase(model, 4096, W25Q_MODEL_TSE_US);
+            }
+            break;
+            
+        case CMD_BLOCK_ERASE_32KB:
+            if (model->wel == 1 && model->index == 4)
+            {
+                W25Q_MODEL_StartErase(model, 32768, W25Q_MODEL_TBE32_US);
+            }
+            break;
+            
+        case CMD_BLOCK_ERASE_64KB:
+            if (model->wel == 1 && model->index == 4)
+            {
+                W25Q_MODEL_StartErase(model, 65536, W25Q_MODEL_TBE64_US);
+            }
+            break;
+            
+        case CMD_CHIP_ERASE:
+        case CMD_CHIP_ERASE_ALT:
+            if (model->wel == 1 && model->index == 1)
+            {
+                model->address = 0;
+                W25Q_MODEL_StartErase(model, W25Q_MODEL_SIZE, W25Q_MODEL_TCE_US);
+            }
+            break;
+            
+        case CMD_ERASE_SUSPEND:
+            // Chip erase cannot be suspended
+            if (model->erase_active && !model->erase_suspended && model->erase_size != W25Q_MODEL_SIZE)
+            {
+                uint64_t now = HOST_GetMicros();
+                
+                model->erase_remaining_us = (model->erase_until_us > now) ? model->erase_until_us - now : 0;
+                model->erase_suspended = 1;
+            }
+            break;
+            
+        case CMD_ERASE_RESUME:
+            if (model->erase_suspended)
+            {
+                model->erase_until_us = HOST_GetMicros() + model->erase_remaining_us;
+                model->erase_suspended = 0;
+            }
+            break;
+            
+        case CMD_POWER_DOWN:
+            model->power_down = 1;
+            break;
+            
+        case CMD_RELEASE_POWER_DOWN:
+            model->power_down = 0;
+            break;
+            
+        default:
+            break;
+    }
+}
+
+/**
+  * @brief  Decide whether an instruction is accepted in the current state
+  * @param  model: Pointer to model
+  * @param  opcode: Instruction
+  * @retval 1 when accepted
+  */
+static uint8_t W25Q_MODEL_Accept(W25Q_MODEL_t *model, uint8_t opcode)
+{
+    if (model->power_down)
+    {
+        return opcode == CMD_RELEASE_POWER_DOWN;
+    }
+    
+    if (W25Q_MODEL_Busy(model))
+    {
+        return opcode == CMD_READ_STATUS_REG1 || opcode == CMD_READ_STATUS_REG2 ||
+               opcode == CMD_ERASE_SUSPEND;
+    }
+    
+    // While an erase is suspended, a new erase must wait for the resume
+    if (model->erase_suspended &&
+        (opcode == CMD_SECTOR_ERASE_4KB || opcode == CMD_BLOCK_ERASE_32KB ||
+         opcode == CMD_BLOCK_ERASE_64KB || opcode == CMD_CHIP_ERASE || opcode == CMD_CHIP_ERASE_ALT))
+    {
+        return 0;
+    }
+    
+    return 1;
+}
+
+/**
+  * @brief  Clock one byte through the selected device
+  * @param  model: Pointer to model
+  * @param  mosi: Byte sent by the MCU
+  * @retval Byte returned on MISO
+  */
+static uint8_t W25Q_MODEL_Transfer(W25Q_MODEL_t *model, uint8_t mosi)
+{
+    uint32_t index = model->index++;
+    uint8_t address_end = 4;
+    
+    if (index == 0)
+    {
+        model->opcode = mosi;
+        model->ignored = !W25Q_MODEL_Accept(model, mosi);
+        return 0xFF;
+    }
+    
+    if (model->ignored)
+    {
+        return 0xFF;
+    }
+    
+    switch (model->opcode)
+    {
+        case CMD_READ_STATUS_REG1:
+            return W25Q_MODEL_Status1(model);
+            
+        case CMD_READ_STATUS_REG2:
+            W25Q_MODEL_Update(model);
+            return model->erase_suspended ? SR2_SUS : 0;
+            
+        case CMD_JEDEC_ID:
+            return (index <= 3) ? jedec_id[index - 1] : 0xFF;
+            
+        case CMD_RELEASE_POWER_DOWN:
+            return (index >= 4) ? jedec_id[2] - 1 : 0xFF;
+            
+        case CMD_UNIQUE_ID:
+            return (index >= 5 && index < 13) ? model->unique_id[index - 5] : 0xFF;
+            
+        default:
+            break;
+    }
+    
+    // Instructions with a 24-bit address
+    switch (model->opcode)
+    {
+        case CMD_MANUFACTURER_ID:
+        case CMD_READ_DATA:
+        case CMD_FAST_READ:
+        case CMD_READ_SFDP:
+        case CMD_PAGE_PROGRAM:
+        case CMD_SECTOR_ERASE_4KB:
+        case CMD_BLOCK_ERASE_32KB:
+        case CMD_BLOCK_ERASE_64KB:
+            break;
+            
+        default:
+            return 0xFF;
+    }
+    
+    if (index < address_end)
+    {
+        model->address = (model->address << 8) | mosi;
+        return 0xFF;
+    }
+    
+    // FAST READ and SFDP read take 8 dummy clocks
+    if (model->opcode == CMD_FAST_READ || model->opcode == CMD_READ_SFDP)
+    {
+        if (index == address_end)
+        {
+            return 0xFF;
+        }
+        index--;
+    }
+    
+    switch (model->opcode)
+    {
+        case CMD_MANUFACTURER_ID:
+            return ((model->address + index - address_end) & 1) ? jedec_id[2] - 1 : jedec_id[0];
+            
+        case CMD_READ_DATA:
+        case CMD_FAST_READ:
+        {
+            uint8_t data = model->array[model->address & (W25Q_MODEL_SIZE - 1)];
+            model->address++;
+            model->bytes_read++;
+            return data;
+        }
+        
+        case CMD_READ_SFDP:
+        {
+            uint32_t address = model->address++;
+            return (address < W25Q_MODEL_SFDP_SIZE) ? model->sfdp[address] : 0xFF;
+        }
+        
+        case CMD_PAGE_PROGRAM:
+            // Data wraps around inside the page, the last 256 bytes win
+            model->page[(model->address + index - address_end) & (W25Q_MODEL_PAGE_SIZE - 1)] = mosi;
+            return 0xFF;
+            
+        default:
+            return 0xFF;
+    }
+}
+
+/**
+  * @brief  Initialize a model
+  * @param  model: Pointer to model
+  * @param  image_path: File backing the array (created if missing), or NULL
+  * @retval 0 on success, -1 on error
+  */
+int W25Q_MODEL_Init(W25Q_MODEL_t *model, const char *image_path)
+{
+    struct stat st;
+    uint32_t i;
+    
+    memset(model, 0, sizeof(*model));
+    model->fd = -1;
+    model->time_scale = 100;
+    
+    if (image_path != NULL)
+    {
+        model->fd = open(image_path, O_RDWR | O_CREAT, 0644);
+        if (model->fd < 0 || fstat(model->fd, &st) != 0)
+        {
+            return -1;
+        }
+        
+        if (ftruncate(model->fd, W25Q_MODEL_SIZE) != 0)
+        {
+            return -1;
+        }
+        
+        model->array = mmap(NULL, W25Q_MODEL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, model->fd, 0);
+        if (model->array == MAP_FAILED)
+        {
+            model->array = NULL;
+            return -1;
+        }
+        
+        // A new (or grown) image starts out erased
+        if ((uint64_t)st.st_size < W25Q_MODEL_SIZE)
+        {
+            memset(&model->array[st.st_size], 0xFF, W25Q_MODEL_SIZE - st.st_size);
+        }
+    }
+    else
+    {
+        model->array = malloc(W25Q_MODEL_SIZE);
+        if (model->array == NULL)
+        {
+            return -1;
+        }
+        memset(model->array, 0xFF, W25Q_MODEL_SIZE);
+    }
+    
+    memset(model->sfdp, 0xFF, sizeof(model->sfdp));
+    memcpy(model->sfdp, "SFDP", 4);
+    model->sfdp[4] = 0x06;            // JESD216B
+    model->sfdp[5] = 0x01;
+    model->sfdp[6] = 0x00;            // One parameter header
+    model->sfdp[8] = 0x00;            // BFPT
+    model->sfdp[9] = 0x06;
+    model->sfdp[10] = 0x01;
+    model->sfdp[11] = 16;             // DWORDs
+    model->sfdp[12] = 0x80;           // Table pointer
+    model->sfdp[13] = 0x00;
+    model->sfdp[14] = 0x00;
+    
+    for (i = 0; i < 16; i++)
+    {
+        model->sfdp[0x80 + i * 4] = bfpt[i] & 0xFF;
+        model->sfdp[0x80 + i * 4 + 1] = (bfpt[i] >> 8) & 0xFF;
+        model->sfdp[0x80 + i * 4 + 2] = (bfpt[i] >> 16) & 0xFF;
+        model->sfdp[0x80 + i * 4 + 3] = (bfpt[i] >> 24) & 0xFF;
+    }
+    
+    for (i = 0; i < sizeof(model->unique_id); i++)
+    {
+        model->unique_id[i] = 0xD0 + i;
+    }
+    
+    return 0;
+}
+
+/**
+  * @brief  Release a model (the image file keeps the array contents)
+  * @param  model: Pointer to model
+  * @retval None
+  */
+void W25Q_MODEL_Close(W25Q_MODEL_t *model)
+{
+    uint8_t i;
+    
+    for (i = 0; i < device_count; i++)
+    {
+        if (devices[i] == model)
+        {
+            devices[i] = devices[--device_count];
+            break;
+        }
+    }
+    
+    if (model->fd >= 0)
+    {
+        msync(model->array, W25Q_MODEL_SIZE, MS_SYNC);
+        munmap(model->array, W25Q_MODEL_SIZE);
+        close(model->fd);
+        model->fd = -1;
+    }
+    else
+    {
+        free(model->array);
+    }
+    model->array = NULL;
+}
+
+/**
+  * @brief  Connect a model to an SPI bus and a CS pin
+  * @param  model: Pointer to model
+  * @param  spi: SPI instance
+  * @param  cs_port: CS GPIO port
+  * @param  cs_pin: CS GPIO pin
+  * @retval None
+  */
+void W25Q_MODEL_Attach(W25Q_MODEL_t *model, SPI_TypeDef *spi, GPIO_TypeDef *cs_port, uint16_t cs_pin)
+{
+    model->spi = spi;
+    model->cs_port = cs_port;
+    model->cs_pin = cs_pin;
+    
+    if (device_count < W25Q_MODEL_MAX_DEVICES)
+    {
+        devices[device_count++] = model;
+    }
+}
+
+/**
+  * @brief  Forward a GPIO change to the device using it as CS
+  * @param  port: GPIO port
+  * @param  pin: GPIO pin(s)
+  * @param  state: New level
+  * @retval None
+  */
+void W25Q_MODEL_SetPin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state)
+{
+    uint8_t i;
+    
+    for (i = 0; i < device_count; i++)
+    {
+        W25Q_MODEL_t *model = devices[i];
+        
+        if (model->cs_port != port || (model->cs_pin & pin) == 0)
+        {
+            continue;
+        }
+        
+        if (state == GPIO_PIN_RESET && !model->selected)
+        {
+            W25Q_MODEL_Select(model);
+        }
+        else if (state == GPIO_PIN_SET && model->selected)
+        {
+            W25Q_MODEL_Deselect(model);
+        }
+    }
+}
+
+/**
+  * @brief  Exchange one byte on an SPI bus
+  * @param  spi: SPI instance
+  * @param  mosi: Byte sent by the MCU
+  * @retval Byte from the selected device, 0xFF if none is selected
+  */
+uint8_t W25Q_MODEL_Exchange(SPI_TypeDef *spi, uint8_t mosi)
+{
+    uint8_t i;
+    
+    for (i = 0; i < device_count; i++)
+    {
+        if (devices[i]->spi == spi && devices[i]->selected)
+        {
+            return W25Q_MODEL_Transfer(devices[i], mosi);
+        }
+    }
+    
+    return 0xFF;
+}
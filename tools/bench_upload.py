@@ -0,0 +1,302 @@
+#!/usr/bin/env python3
+"""
+W25Q128 UART Bootloader - Upload Throughput Benchmark
+-----------------------------------------------------
+Runs the upload path of flash_upload.py (erase, write, device CRC32 check)
+over a sweep of chunk sizes, baud rates, packet integrity modes (CRC16 in
+software, CRC32 on the device CRC unit) and image shapes, and writes one
+CSV row per run with the time spent in each phase.
+
+By default every run starts a fresh host build of the bootloader
+(Host/, target flash_host) on a pseudo terminal with an erased simulated
+W25Q128, so the numbers do not need hardware. With --port the same sweep
+runs against a real board instead (flash model columns stay empty).
+
+Usage:
+    cmake --preset host && cmake --build build/host --target bench
+    python bench_upload.py --host-binary build/host/Host/flash_host -o bench.csv
+    python bench_upload.py --port /dev/ttyUSB0 --baudrates 921600,2000000
+    python bench_upload.py --host-binary build/host/Host/flash_host --integrity crc32
+
+Columns:
+    erase_s, write_s, verify_s   wall time of each phase
+    bytes_per_s                  image size / (erase_s + write_s)
+    write_wire_s                 bytes sent during the write phase at the line rate
+    write_crc_s                  host time spent computing packet checksums
+                                 (CRC16 or CRC32, as the integrity column)
+    turnaround_s                 write_s - write_wire_s - write_crc_s: device
+                                 processing and host/device round trips
+                                 not hidden behind the transfer (negative when
+                                 CRC work overlaps bytes still on the wire)
+    flash_program_s, flash_erase_s
+                                 busy time the simulated flash spent
+                                 programming pages / erasing (host runs only)
+
+Requirements:
+    pip install pyserial
+"""
+
+import argparse
+import contextlib
+import csv
+import io
+import os
+import random
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+import zlib
+from pathlib import Path
+
+from flash_upload import W25Q64Flasher, MAX_CHUNK_SIZE, WINDOW_SIZE, INTEGRITY_CRC16, INTEGRITY_CRC32
+
+# Sweep defaults
+DEFAULT_CHUNK_SIZES = [1024, 4096]
+DEFAULT_BAUDRATES = [921600, 3000000]
+DEFAULT_IMAGES = ['random', 'sparse', 'blank', 'animations']
+DEFAULT_INTEGRITIES = ['crc16', 'crc32']
+INTEGRITY_MODES = {'crc16': INTEGRITY_CRC16, 'crc32': INTEGRITY_CRC32}
+DEFAULT_IMAGE_SIZE = 128 * 1024
+POWER_ON_BAUDRATE = 115200  # MX_USART1_UART_Init
+HOST_START_TIMEOUT = 5.0  # seconds for flash_host to print its banner
+ANIMATIONS_FILE = Path(__file__).resolve().parent / 'animations.bin'
+
+CSV_FIELDS = [
+    'image', 'size', 'chunk_size', 'baudrate', 'window', 'integrity',
+    'erase_s', 'write_s', 'verify_s', 'total_s', 'bytes_per_s',
+    'tx_bytes', 'rx_bytes', 'write_wire_s', 'write_crc_s', 'turnaround_s',
+    'page_programs', 'erases', 'flash_program_s', 'flash_erase_s', 'result',
+]
+
+
+class CountingSerial:
+    """Serial port wrapper counting the bytes moved in each direction"""
+    
+    def __init__(self, ser):
+        self.__dict__['ser'] = ser
+        self.__dict__['tx_bytes'] = 0
+        self.__dict__['rx_bytes'] = 0
+    
+    def write(self, data):
+        self.__dict__['tx_bytes'] += len(data)
+        return self.ser.write(data)
+    
+    def read(self, size=1):
+        data = self.ser.read(size)
+        self.__dict__['rx_bytes'] += len(data)
+        return data
+    
+    def __getattr__(self, name):
+        return getattr(self.ser, name)
+    
+    def __setattr__(self, name, value):
+        setattr(self.ser, name, value)
+
+
+def make_image(shape, size, seed=1):
+    """Build a test image: random, sparse (mostly 0xFF), blank or animations"""
+    rng = random.Random(seed)
+    if shape == 'random':
+        return bytes(rng.getrandbits(8) for _ in range(size))
+    if shape == 'sparse':
+        # One short burst of data per 4KB sector, the rest stays erased
+        image = bytearray(b'\xFF' * size)
+        for sector in range(0, size, 4096):
+            offset = sector + rng.randrange(0, 4096 - 64)
+            if offset + 64 <= size:
+                image[offset:offset + 64] = bytes(rng.getrandbits(8) for _ in range(64))
+        return bytes(image)
+    if shape == 'blank':
+        return b'\xFF' * size
+    if shape == 'animations':
+        return ANIMATIONS_FILE.read_bytes()
+    raise ValueError(f"unknown image shape: {shape}")
+
+
+class HostDevice:
+    """flash_host process serving the bootloader on a pseudo terminal"""
+    
+    def __init__(self, binary, time_scale):
+        self.workdir = tempfile.TemporaryDirectory(prefix='bench_upload_')
+        self.port = os.path.join(self.workdir.name, 'tty')
+        image = os.path.join(self.workdir.name, 'flash.img')
+        self.process = subprocess.Popen(
+            [binary, '-i', image, '-l', self.port, '-t', str(time_scale)],
+            stdout=subprocess.PIPE, text=True)
+        
+        deadline = time.time() + HOST_START_TIMEOUT
+        while time.time() < deadline:
+            line = self.process.stdout.readline()
+            if not line:
+                break
+            if line.startswith('W25Q128:'):
+                return
+        self.stop()
+        raise RuntimeError(f"{binary} did not start")
+    
+    def stop(self):
+        """Stop the process and return its flash counters"""
+        stats = {}
+        if self.process.poll() is None:
+            self.process.send_signal(signal.SIGTERM)
+        output, _ = self.process.communicate(timeout=HOST_START_TIMEOUT)
+        for line in output.splitlines():
+            if line.startswith('STATS '):
+                for field in line.split()[1:]:
+                    key, value = field.split('=')
+                    stats[key] = int(value)
+        self.workdir.cleanup()
+        return stats
+
+
+def run_once(port, image_name, data, chunk_size, baudrate, window, integrity):
+    """Erase, write and check one image, returning the measured phases"""
+    row = {'image': image_name, 'size': len(data), 'chunk_size': chunk_size,
+           'baudrate': baudrate, 'window': window, 'integrity': integrity, 'result': 'ok'}
+    crc_time = [0.0]
+    
+    # The tool's progress output would drown the CSV
+    with contextlib.redirect_stdout(io.StringIO()):
+        flasher = W25Q64Flasher(port, POWER_ON_BAUDRATE, window, chunk_size, ready_delay=0.1)
+        flasher.ser = CountingSerial(flasher.ser)
+        packet_checksum = flasher.packet_checksum
+        
+        # Every write packet gets its checksum here, whichever mode is active
+        def timed_checksum(payload):
+            start = time.perf_counter()
+            checksum = packet_checksum(payload)
+            crc_time[0] += time.perf_counter() - start
+            return checksum
+        flasher.packet_checksum = timed_checksum
+        
+        try:
+            if baudrate != POWER_ON_BAUDRATE and not flasher.set_baudrate(baudrate):
+                row['result'] = 'baudrate'
+                return row
+            if integrity != 'crc16' and not flasher.set_integrity(INTEGRITY_MODES[integrity]):
+                row['result'] = 'integrity'
+                return row
+            if not flasher.get_info():
+                row['result'] = 'info'
+                return row
+            
+            start = time.perf_counter()
+            ok = flasher.erase_sectors(0, len(data))
+            row['erase_s'] = time.perf_counter() - start
+            if not ok:
+                row['result'] = 'erase'
+                return row
+            
+            tx_before = flasher.ser.tx_bytes
+            crc_time[0] = 0.0
+            start = time.perf_counter()
+            ok = flasher.write_range(0, data)
+            row['write_s'] = time.perf_counter() - start
+            write_tx = flasher.ser.tx_bytes - tx_before
+            row['write_wire_s'] = write_tx * 10 / baudrate
+            row['write_crc_s'] = crc_time[0]
+            row['turnaround_s'] = row['write_s'] - row['write_wire_s'] - row['write_crc_s']
+            if not ok:
+                row['result'] = 'write'
+                return row
+            
+            start = time.perf_counter()
+            ok = flasher.flash_crc32(0, len(data)) == zlib.crc32(data)
+            row['verify_s'] = time.perf_counter() - start
+            if not ok:
+                row['result'] = 'verify'
+            
+            row['total_s'] = row['erase_s'] + row['write_s'] + row['verify_s']
+            row['bytes_per_s'] = len(data) / (row['erase_s'] + row['write_s'])
+        finally:
+            row['tx_bytes'] = flasher.ser.tx_bytes
+            row['rx_bytes'] = flasher.ser.rx_bytes
+            flasher.close()
+    
+    return row
+
+
+def parse_list(text, convert=str):
+    return [convert(item) for item in text.split(',') if item]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='W25Q128 UART Bootloader - Upload Benchmark')
+    target = parser.add_mutually_exclusive_group(required=True)
+    target.add_argument('--host-binary', help='flash_host executable (simulated device per run)')
+    target.add_argument('-p', '--port', help='Serial port of a real device')
+    parser.add_argument('--chunk-sizes', default=','.join(map(str, DEFAULT_CHUNK_SIZES)),
+                        help='Comma separated write chunk sizes')
+    parser.add_argument('--baudrates', default=','.join(map(str, DEFAULT_BAUDRATES)),
+                        help='Comma separated baud rates')
+    parser.add_argument('--integrity', default=','.join(DEFAULT_INTEGRITIES),
+                        help='Comma separated packet checksums: crc16, crc32')
+    parser.add_argument('--images', default=','.join(DEFAULT_IMAGES),
+                        help='Comma separated shapes: random, sparse, blank, animations')
+    parser.add_argument('--size', type=int, default=DEFAULT_IMAGE_SIZE,
+                        help=f'Synthetic image size in bytes (default: {DEFAULT_IMAGE_SIZE})')
+    parser.add_argument('-w', '--window', type=int, default=WINDOW_SIZE,
+                        help=f'Write packets in flight (default: {WINDOW_SIZE})')
+    parser.add_argument('-t', '--time-scale', type=int, default=100,
+                        help='Simulated flash busy times in percent of the datasheet (default: 100)')
+    parser.add_argument('-o', '--output', help='CSV file (default: stdout)')
+    
+    args = parser.parse_args()
+    
+    chunk_sizes = parse_list(args.chunk_sizes, int)
+    baudrates = parse_list(args.baudrates, int)
+    images = parse_list(args.images)
+    integrities = parse_list(args.integrity)
+    for integrity in integrities:
+        if integrity not in INTEGRITY_MODES:
+            print(f"Invalid integrity mode: {integrity} (crc16, crc32)", file=sys.stderr)
+            sys.exit(1)
+    for chunk_size in chunk_sizes:
+        if not 1 <= chunk_size <= MAX_CHUNK_SIZE:
+            print(f"Invalid chunk size: {chunk_size} (1..{MAX_CHUNK_SIZE})", file=sys.stderr)
+            sys.exit(1)
+    
+    output = open(args.output, 'w', newline='') if args.output else sys.stdout
+    writer = csv.DictWriter(output, fieldnames=CSV_FIELDS)
+    writer.writeheader()
+    
+    failures = 0
+    for image_name in images:
+        data = make_image(image_name, args.size)
+        for baudrate in baudrates:
+            for chunk_size in chunk_sizes:
+                for integrity in integrities:
+                    print(f"{image_name} {len(data)} bytes, {baudrate} baud, {chunk_size} byte chunks, {integrity}... ",
+                          end='', flush=True, file=sys.stderr)
+                    device = HostDevice(args.host_binary, args.time_scale) if args.host_binary else None
+                    port = device.port if device else args.port
+                    try:
+                        row = run_once(port, image_name, data, chunk_size, baudrate, args.window, integrity)
+                    finally:
+                        stats = device.stop() if device else {}
+                    
+                    if stats:
+                        row['page_programs'] = stats.get('page_programs')
+                        row['erases'] = stats.get('erases')
+                        row['flash_program_s'] = stats.get('program_busy_us', 0) / 1e6
+                        row['flash_erase_s'] = stats.get('erase_busy_us', 0) / 1e6
+                    for key, value in row.items():
+                        if isinstance(value, float):
+                            row[key] = f"{value:.4f}"
+                    
+                    writer.writerow(row)
+                    output.flush()
+                    if row['result'] != 'ok':
+                        failures += 1
+                    print(row['result'] if row['result'] != 'ok' else f"{row['bytes_per_s']} B/s",
+                          file=sys.stderr)
+    
+    if args.output:
+        output.close()
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == '__main__':
+    main()
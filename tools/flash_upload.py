@@ -16,6 +16,8 @@ import struct
 import time
 import sys
 import argparse
+import binascii
+import zlib
 from pathlib import Path
 
 # Protocol constants
@@ -23,6 +25,7 @@ BOOT_START_MARKER1 = 0xAA
 BOOT_START_MARKER2 = 0x55
 BOOT_ACK = 0x79
 BOOT_NACK = 0x1F
+BOOT_NO_ADDRESS = 0xFFFFFFFF  # Write NACK for the packet just sent
 
 # Commands
 BOOT_CMD_WRITE = 0x01
@@ -30,18 +33,62 @@ BOOT_CMD_READ = 0x02
 BOOT_CMD_ERASE_SECTOR = 0x03
 BOOT_CMD_ERASE_CHIP = 0x04
 BOOT_CMD_GET_INFO = 0x05
+BOOT_CMD_VERIFY = 0x06
+BOOT_CMD_SYNC = 0x07
+BOOT_CMD_WRITE_WINDOW = 0x08
+BOOT_CMD_SET_BAUD = 0x09
+BOOT_CMD_ERASE_RANGE = 0x0A
+BOOT_CMD_HASH_SECTORS = 0x0B
+BOOT_CMD_JOB_STATUS = 0x0C
+BOOT_CMD_GET_STATS = 0x0D
+BOOT_CMD_SET_INTEGRITY = 0x0E
+
+# Packet checksums (BOOT_Integrity_t)
+INTEGRITY_CRC16 = 0x00
+INTEGRITY_CRC32 = 0x01
+
+# Bit-reversed value of every byte, to get CRC-32/MPEG-2 out of zlib.crc32
+BIT_REVERSE = bytes(int(f'{i:08b}'[::-1], 2) for i in range(256))
+
+# BOOT_CMD_GET_STATS flags and profiling points (PROF_Point_t order)
+STATS_CLEAR = 0x01
+PROF_POINTS = ['flash_read', 'flash_read_async', 'flash_write_page', 'flash_wait_spin', 'flash_erase_4kb',
+               'flash_erase_32kb', 'flash_erase_64kb', 'flash_erase_chip', 'boot_crc16']
+
+# Background job states (BOOT_JobState_t)
+JOB_IDLE = 0x00
+JOB_BUSY = 0x01
+JOB_DONE = 0x02
+JOB_FAILED = 0x03
 
 # Configuration
 MAX_CHUNK_SIZE = 4096  # Maximum data per packet
 SECTOR_SIZE = 4096
+BLOCK_SIZE_64KB = 65536
+HASH_MAX_SECTORS = 256  # Must match BOOT_HASH_MAX_SECTORS in firmware
+BLOCK_ERASE_MAX_TIME = 2.0  # seconds, datasheet tBE2 max for a 64KB block
+CHIP_ERASE_MAX_TIME = 200.0  # seconds, datasheet tCE max
+JOB_POLL_INTERVAL = 0.1  # seconds between BOOT_CMD_JOB_STATUS polls
 TIMEOUT = 5  # seconds
+WINDOW_SIZE = 3  # Packets in flight, must not exceed BOOT_WINDOW_SIZE in firmware
+MAX_RETRIES = 5
+BAUD_PROBE_TIMEOUT = 1.0  # Must match BOOT_BAUD_PROBE_MS in firmware
+# Candidate rates for negotiation, fastest first (FT232RL tops out at 3 Mbaud)
+BAUD_CANDIDATES = [3000000, 2000000, 1500000, 1000000, 921600, 460800, 230400]
 
 class W25Q64Flasher:
-    def __init__(self, port, baudrate=115200):
+    def __init__(self, port, baudrate=115200, window=WINDOW_SIZE, chunk_size=MAX_CHUNK_SIZE, ready_delay=2.0):
         """Initialize serial connection"""
+        if not 1 <= chunk_size <= MAX_CHUNK_SIZE:
+            raise ValueError(f"chunk size must be 1..{MAX_CHUNK_SIZE}")
+        self.window = window
+        self.chunk_size = chunk_size
+        self.initial_baudrate = baudrate
+        self.integrity = INTEGRITY_CRC16
+        self.failed_address = None  # From the last write/sync NACK
         try:
             self.ser = serial.Serial(port, baudrate, timeout=TIMEOUT)
-            time.sleep(2)  # Wait for device to be ready
+            time.sleep(ready_delay)  # Wait for device to be ready
             print(f"Connected to {port} at {baudrate} baud")
         except serial.SerialException as e:
             print(f"Error opening serial port: {e}")
@@ -50,20 +97,92 @@ class W25Q64Flasher:
     def close(self):
         """Close serial connection"""
         if self.ser and self.ser.is_open:
+            # Leave the device at CRC16 and its power-on rate for the next session
+            if self.integrity != INTEGRITY_CRC16:
+                self.set_integrity(INTEGRITY_CRC16)
+            if self.ser.baudrate != self.initial_baudrate:
+                self.set_baudrate(self.initial_baudrate)
             self.ser.close()
     
+    def set_baudrate(self, baudrate):
+        """Switch device and host to a new baud rate, True if the probe succeeded"""
+        old_baudrate = self.ser.baudrate
+        self.ser.reset_input_buffer()
+        self.send_command(BOOT_CMD_SET_BAUD, struct.pack('<I', baudrate))
+        response = self.ser.read(1)
+        if len(response) != 1 or response[0] != BOOT_ACK:
+            return False
+        
+        try:
+            self.ser.baudrate = baudrate
+        except (ValueError, serial.SerialException):
+            # Adapter cannot do this rate; let the device time out and revert
+            time.sleep(BAUD_PROBE_TIMEOUT + 0.2)
+            return False
+        
+        time.sleep(0.02)  # Let the device finish reconfiguring its UART
+        self.ser.reset_input_buffer()
+        self.send_command(BOOT_CMD_SET_BAUD)
+        
+        old_timeout = self.ser.timeout
+        self.ser.timeout = BAUD_PROBE_TIMEOUT / 2
+        response = self.ser.read(1)
+        self.ser.timeout = old_timeout
+        if len(response) == 1 and response[0] == BOOT_ACK:
+            return True
+        
+        # Probe failed: the device returns to the old rate after BOOT_BAUD_PROBE_MS
+        self.ser.baudrate = old_baudrate
+        time.sleep(BAUD_PROBE_TIMEOUT)
+        self.ser.reset_input_buffer()
+        return False
+    
+    def negotiate_baudrate(self, max_baudrate):
+        """Switch to the fastest candidate rate up to max_baudrate that works"""
+        for baudrate in BAUD_CANDIDATES:
+            if baudrate > max_baudrate or baudrate <= self.ser.baudrate:
+                continue
+            print(f"Trying {baudrate} baud... ", end='', flush=True)
+            if self.set_baudrate(baudrate):
+                print("OK")
+                return True
+            print("failed")
+        print(f"Staying at {self.ser.baudrate} baud")
+        return False
+    
     def calculate_crc16(self, data):
         """Calculate CRC16-CCITT"""
-        crc = 0xFFFF
-        for byte in data:
-            crc ^= byte << 8
-            for _ in range(8):
-                if crc & 0x8000:
-                    crc = (crc << 1) ^ 0x1021
-                else:
-                    crc <<= 1
-                crc &= 0xFFFF
-        return crc
+        # crc_hqx is the same CRC (poly 0x1021, MSB first), table driven in C
+        return binascii.crc_hqx(data, 0xFFFF)
+    
+    def calculate_crc32_words(self, data):
+        """CRC-32/MPEG-2 over little endian words, as the STM32 CRC unit"""
+        padded = bytes(data) + bytes(-len(data) % 4)
+        # The unit takes each word MSB first: byte 3, 2, 1, 0
+        swapped = bytearray(len(padded))
+        for i in range(4):
+            swapped[i::4] = padded[3 - i::4]
+        # zlib's reflected CRC of bit-reversed bytes is the bit-reversed
+        # register of the non-reflected CRC (same init, final XOR undone)
+        crc = zlib.crc32(swapped.translate(BIT_REVERSE)) ^ 0xFFFFFFFF
+        return int(f'{crc:032b}'[::-1], 2)
+    
+    def packet_checksum(self, data):
+        """Checksum trailer of write/read packets in the current integrity mode"""
+        if self.integrity == INTEGRITY_CRC32:
+            return struct.pack('<I', self.calculate_crc32_words(data))
+        return struct.pack('<H', self.calculate_crc16(data))
+    
+    def set_integrity(self, mode):
+        """Select the packet checksum, False if the device refuses it"""
+        self.send_command(BOOT_CMD_SET_INTEGRITY, bytes([mode]))
+        response = self.ser.read(1)
+        if len(response) != 1 or response[0] != BOOT_ACK:
+            # Older firmware NACKs the unknown command
+            self.ser.reset_input_buffer()
+            return False
+        self.integrity = mode
+        return True
     
     def send_command(self, command, data=b''):
         """Send command packet"""
@@ -92,6 +211,25 @@ class W25Q64Flasher:
             print(f"Unexpected response: 0x{response[0]:02X}")
             return False
     
+    def wait_for_write_ack(self):
+        """Wait for a write/sync response, noting the failed address of a NACK"""
+        self.failed_address = None
+        response = self.ser.read(1)
+        if len(response) == 0:
+            print("Timeout waiting for response")
+            return False
+        if response[0] == BOOT_ACK:
+            return True
+        if response[0] != BOOT_NACK:
+            print(f"Unexpected response: 0x{response[0]:02X}")
+            return False
+        
+        # A pipelined write may fail after its ACK; the NACK names the packet
+        failed = self.ser.read(4)
+        if len(failed) == 4:
+            self.failed_address = struct.unpack('<I', failed)[0]
+        return False
+    
     def get_info(self):
         """Get flash information"""
         print("Getting flash info...")
@@ -129,8 +267,165 @@ class W25Q64Flasher:
             'sector_size': sector_size
         }
     
+    def job_status(self):
+        """Poll the background job, None if the firmware lacks BOOT_CMD_JOB_STATUS"""
+        self.send_command(BOOT_CMD_JOB_STATUS)
+        response = self.ser.read(1)
+        if len(response) != 1 or response[0] != BOOT_ACK:
+            return None
+        
+        status = self.ser.read(14)
+        if len(status) != 14:
+            return None
+        
+        state, command, elapsed_ms, done, total = struct.unpack('<BBIII', status)
+        return {
+            'state': state,
+            'command': command,
+            'elapsed_ms': elapsed_ms,
+            'done': done,
+            'total': total
+        }
+    
+    def get_stats(self, clear=False):
+        """Read the firmware profiling statistics, None if unsupported"""
+        self.send_command(BOOT_CMD_GET_STATS, bytes([STATS_CLEAR if clear else 0]))
+        response = self.ser.read(7)
+        if len(response) != 7 or response[0] != BOOT_ACK:
+            return None
+        
+        points, buckets, hclk_hz = struct.unpack('<BBI', response[1:7])
+        stats = {'hclk_hz': hclk_hz, 'points': {}}
+        for point in range(points):
+            record = self.ser.read(20 + buckets * 4)
+            if len(record) != 20 + buckets * 4:
+                return None
+            count, minimum, maximum, total = struct.unpack('<IIIQ', record[:20])
+            name = PROF_POINTS[point] if point < len(PROF_POINTS) else f"point_{point}"
+            stats['points'][name] = {
+                'count': count,
+                'min': minimum,
+                'max': maximum,
+                'total': total,
+                'histogram': list(struct.unpack(f'<{buckets}I', record[20:]))
+            }
+        return stats
+    
+    def print_stats(self, clear=False):
+        """Print the profiling statistics as a table in microseconds"""
+        stats = self.get_stats(clear)
+        if stats is None:
+            print("Profiling statistics not supported")
+            return False
+        if not stats['points']:
+            print("Firmware built without PROF_ENABLED")
+            return True
+        
+        us_per_cycle = 1e6 / stats['hclk_hz']
+        
+        def percentile(point, fraction):
+            # Upper bound: edge of the log2 bucket holding the percentile,
+            # but never above the largest call actually seen
+            seen = 0
+            for bucket, calls in enumerate(point['histogram']):
+                seen += calls
+                if seen >= point['count'] * fraction:
+                    return min(1 << bucket, point['max']) * us_per_cycle
+            return point['max'] * us_per_cycle
+        
+        print(f"{'point':<18}{'calls':>9}{'min':>11}{'avg':>11}{'p50 bound':>11}{'p99 bound':>11}{'max':>11}  (us)")
+        for name, point in stats['points'].items():
+            count = point['count']
+            if count == 0:
+                print(f"{name:<18}{0:>9}")
+                continue
+            print(f"{name:<18}{count:>9}"
+                  f"{point['min'] * us_per_cycle:>11.1f}"
+                  f"{point['total'] / count * us_per_cycle:>11.1f}"
+                  f"{percentile(point, 0.5):>11.1f}"
+                  f"{percentile(point, 0.99):>11.1f}"
+                  f"{point['max'] * us_per_cycle:>11.1f}")
+        print("p50/p99 bound: upper edge of the log2 histogram bucket, capped at max")
+        return True
+    
+    def wait_job(self, max_time):
+        """Poll until the background erase ends"""
+        deadline = time.time() + TIMEOUT + max_time
+        while time.time() < deadline:
+            status = self.job_status()
+            if status is None:
+                # Older firmware: the erase already finished before the ACK
+                self.ser.reset_input_buffer()
+                return True
+            if status['state'] != JOB_BUSY:
+                print(f"\r  {status['done']}/{status['total']} bytes erased in "
+                      f"{status['elapsed_ms'] / 1000:.1f} s")
+                return status['state'] == JOB_DONE
+            
+            print(f"\r  {status['done']}/{status['total']} bytes, "
+                  f"{status['elapsed_ms'] / 1000:.1f} s", end='', flush=True)
+            time.sleep(JOB_POLL_INTERVAL)
+        
+        print("\n  Timeout waiting for erase")
+        return False
+    
+    def erase_range(self, start_address, size):
+        """Erase a range with one command
+        
+        Returns None only if the firmware lacks BOOT_CMD_ERASE_RANGE, False if
+        the range was rejected or the erase failed or timed out.
+        """
+        print(f"Erasing {size} bytes starting at 0x{start_address:08X}... ", end='', flush=True)
+        self.send_command(BOOT_CMD_ERASE_RANGE, struct.pack('<II', size, start_address))
+        
+        # Older firmware erases before the ACK: allow every 64KB block (plus
+        # partial ends) its maximum erase time
+        max_time = (size // BLOCK_SIZE_64KB + 2) * BLOCK_ERASE_MAX_TIME
+        old_timeout = self.ser.timeout
+        self.ser.timeout = TIMEOUT + max_time
+        response = self.ser.read(1)
+        self.ser.timeout = old_timeout
+        
+        if len(response) == 0:
+            print("timeout")
+            return False
+        if response[0] == BOOT_ACK:
+            print("started")
+            return self.wait_job(max_time)
+        if response[0] != BOOT_NACK:
+            print(f"unexpected response 0x{response[0]:02X}")
+            return False
+        
+        # Unknown commands are NACKed too. Firmware with background jobs has
+        # BOOT_CMD_ERASE_RANGE, so there the NACK rejects the range itself.
+        if self.job_status() is not None:
+            print("NACK")
+            return False
+        self.ser.reset_input_buffer()
+        print("not supported - falling back to sector erase")
+        return None
+    
+    def erase_chip(self):
+        """Erase the whole chip, polling the background job"""
+        print("Erasing chip... ", end='', flush=True)
+        self.send_command(BOOT_CMD_ERASE_CHIP)
+        
+        old_timeout = self.ser.timeout
+        self.ser.timeout = TIMEOUT + CHIP_ERASE_MAX_TIME
+        ok = self.wait_for_ack()
+        self.ser.timeout = old_timeout
+        if not ok:
+            return False
+        
+        print("started")
+        return self.wait_job(CHIP_ERASE_MAX_TIME)
+    
     def erase_sectors(self, start_address, size):
         """Erase necessary sectors for the given size"""
+        result = self.erase_range(start_address, size)
+        if result is not None:
+            return result
+        
         num_sectors = (size + SECTOR_SIZE - 1) // SECTOR_SIZE
         print(f"Erasing {num_sectors} sectors starting at 0x{start_address:08X}...")
         
@@ -160,14 +455,77 @@ class W25Q64Flasher:
         cmd_data += data                             # Data
         
         # Calculate CRC
-        crc = self.calculate_crc16(data)
-        cmd_data += struct.pack('<H', crc)
+        cmd_data += self.packet_checksum(data)
         
         # Send command
         self.send_command(BOOT_CMD_WRITE, cmd_data)
         
         # Wait for ACK
-        return self.wait_for_ack()
+        return self.wait_for_write_ack()
+    
+    def send_window_packet(self, seq, address, data):
+        """Send one windowed write packet (CRC covers header and data)"""
+        body = struct.pack('<HII', seq & 0xFFFF, len(data), address) + data
+        self.send_command(BOOT_CMD_WRITE_WINDOW, body + self.packet_checksum(body))
+    
+    def write_windowed(self, start_address, file_data, window=WINDOW_SIZE):
+        """Write data with up to `window` packets in flight (go-back-N)"""
+        chunks = [(start_address + offset, file_data[offset:offset + self.chunk_size])
+                  for offset in range(0, len(file_data), self.chunk_size)]
+        total = len(chunks)
+        base = 0        # Oldest packet not yet acknowledged
+        next_seq = 0    # Next packet to send
+        in_flight = 0   # Responses still expected
+        retries = 0
+        
+        while base < total:
+            while next_seq < total and next_seq - base < window:
+                address, data = chunks[next_seq]
+                self.send_window_packet(next_seq, address, data)
+                next_seq += 1
+                in_flight += 1
+            
+            response = self.ser.read(3)
+            if len(response) != 3:
+                print("\n  Timeout waiting for window response, resending")
+                rewind = base
+                in_flight = 0
+                self.ser.reset_input_buffer()
+            else:
+                in_flight -= 1
+                status = response[0]
+                expected = base + ((struct.unpack('<H', response[1:3])[0] - base) & 0xFFFF)
+                if status == BOOT_ACK and base < expected <= next_seq:
+                    base = expected
+                    retries = 0
+                    progress = (base / total) * 100
+                    print(f"\r  Packet {base}/{total} [{progress:.1f}%] ", end='', flush=True)
+                    continue
+                if status not in (BOOT_ACK, BOOT_NACK):
+                    print(f"\n  Unexpected response: 0x{status:02X}")
+                # Device wants a resend from `expected`; stale values mean start over from base
+                rewind = expected if base <= expected <= next_seq else base
+                # Drain responses for packets sent after the failed one
+                while in_flight > 0:
+                    if len(self.ser.read(3)) != 3:
+                        self.ser.reset_input_buffer()
+                        break
+                    in_flight -= 1
+                in_flight = 0
+            
+            retries += 1
+            if retries > MAX_RETRIES:
+                print(f"\n  Giving up at packet {rewind}")
+                return False
+            base = next_seq = rewind
+        
+        print()
+        return True
+    
+    def sync(self):
+        """Wait until pipelined writes are programmed and report their status"""
+        self.send_command(BOOT_CMD_SYNC)
+        return self.wait_for_write_ack()
     
     def write_file(self, filename, start_address=0x00000000):
         """Write binary file to flash"""
@@ -200,12 +558,24 @@ class W25Q64Flasher:
         
         # Write data in chunks
         print(f"\nWriting {file_size} bytes...")
-        total_chunks = (file_size + MAX_CHUNK_SIZE - 1) // MAX_CHUNK_SIZE
+        if not self.write_range(start_address, file_data):
+            return False
+        
+        print("\nWrite complete!")
+        return True
+    
+    def write_range(self, start_address, data):
+        """Write already erased flash starting at start_address"""
+        if self.window > 0:
+            return self.write_windowed(start_address, data, self.window)
+        
+        data_size = len(data)
+        total_chunks = (data_size + self.chunk_size - 1) // self.chunk_size
         
         for chunk_num in range(total_chunks):
-            offset = chunk_num * MAX_CHUNK_SIZE
-            chunk_size = min(MAX_CHUNK_SIZE, file_size - offset)
-            chunk_data = file_data[offset:offset + chunk_size]
+            offset = chunk_num * self.chunk_size
+            chunk_size = min(self.chunk_size, data_size - offset)
+            chunk_data = data[offset:offset + chunk_size]
             chunk_address = start_address + offset
             
             progress = ((chunk_num + 1) / total_chunks) * 100
@@ -213,11 +583,115 @@ class W25Q64Flasher:
             
             if self.write_data(chunk_address, chunk_data):
                 print("OK")
-            else:
+            elif self.failed_address in (None, BOOT_NO_ADDRESS, chunk_address):
                 print("FAILED")
+                if self.failed_address is None and chunk_num > 0:
+                    # No address from the device: the NACK may be the deferred
+                    # error of the previous, already ACKed chunk
+                    print(f"  (possibly programming of the previous chunk at 0x{chunk_address - self.chunk_size:08X})")
+                return False
+            else:
+                print("rejected")
+                print(f"Programming failed at 0x{self.failed_address:08X} (earlier chunk, reported late by device)")
                 return False
         
-        print("\nWrite complete!")
+        # The device ACKs a packet before programming it; make sure the last one landed
+        if not self.sync():
+            if self.failed_address not in (None, BOOT_NO_ADDRESS):
+                print(f"Programming failed at 0x{self.failed_address:08X} (deferred error reported by device)")
+            else:
+                print("Programming failed (deferred error reported by device)")
+            return False
+        
+        return True
+    
+    def hash_sectors(self, start_address, size):
+        """Get per-sector CRC32 list for a range, None if unsupported or failed"""
+        hashes = []
+        address = start_address
+        end_address = start_address + size
+        
+        while address < end_address:
+            # One request covers at most HASH_MAX_SECTORS sectors
+            request_end = min(end_address, (address // SECTOR_SIZE + HASH_MAX_SECTORS) * SECTOR_SIZE)
+            length = request_end - address
+            count = (request_end - 1) // SECTOR_SIZE - address // SECTOR_SIZE + 1
+            
+            self.send_command(BOOT_CMD_HASH_SECTORS, struct.pack('<II', length, address))
+            old_timeout = self.ser.timeout
+            self.ser.timeout = TIMEOUT + length / (1024 * 1024)
+            response = self.ser.read(1)
+            if len(response) == 1 and response[0] == BOOT_ACK:
+                response = self.ser.read(4 * count)
+            else:
+                response = b''
+            self.ser.timeout = old_timeout
+            
+            if len(response) != 4 * count:
+                return None
+            hashes.extend(struct.unpack(f'<{count}I', response))
+            address = request_end
+        
+        return hashes
+    
+    def sync_file(self, filename, start_address=0x00000000):
+        """Erase and rewrite only the sectors whose content differs from the file"""
+        try:
+            with open(filename, 'rb') as f:
+                file_data = f.read()
+        except IOError as e:
+            print(f"Error reading file: {e}")
+            return False
+        
+        file_size = len(file_data)
+        print(f"\nFile: {filename}")
+        print(f"Size: {file_size} bytes ({file_size/1024:.2f} KB)")
+        print(f"Start address: 0x{start_address:08X}")
+        
+        info = self.get_info()
+        if not info:
+            return False
+        if file_size > info['capacity']:
+            print(f"Error: File size ({file_size}) exceeds flash capacity ({info['capacity']})")
+            return False
+        
+        print("\nHashing sectors on device... ", end='', flush=True)
+        device_hashes = self.hash_sectors(start_address, file_size)
+        if device_hashes is None:
+            print("not supported, doing a full upload")
+            self.ser.reset_input_buffer()
+            return self.write_file(filename, start_address)
+        print(f"{len(device_hashes)} sectors")
+        
+        # Same split as the device: the part of the file inside each sector
+        first_sector = start_address // SECTOR_SIZE
+        changed = []
+        for index, device_hash in enumerate(device_hashes):
+            sector_start = max(start_address, (first_sector + index) * SECTOR_SIZE)
+            sector_end = min(start_address + file_size, (first_sector + index + 1) * SECTOR_SIZE)
+            local = file_data[sector_start - start_address:sector_end - start_address]
+            if zlib.crc32(local) != device_hash:
+                changed.append((sector_start, sector_end))
+        
+        print(f"{len(changed)} of {len(device_hashes)} sectors differ")
+        
+        # Merge adjacent sectors into runs so erase and write stay efficient
+        runs = []
+        for sector_start, sector_end in changed:
+            if runs and runs[-1][1] == sector_start:
+                runs[-1][1] = sector_end
+            else:
+                runs.append([sector_start, sector_end])
+        
+        for run_start, run_end in runs:
+            run_data = file_data[run_start - start_address:run_end - start_address]
+            print(f"\nUpdating 0x{run_start:08X}-0x{run_end:08X}")
+            if not self.erase_sectors(run_start, len(run_data)):
+                return False
+            if not self.write_range(run_start, run_data):
+                return False
+        
+        print("\nSync complete!")
         return True
     
     def verify_data(self, address, expected_data):
@@ -242,16 +716,15 @@ class W25Q64Flasher:
             return False
         
         # Read CRC
-        crc_bytes = self.ser.read(2)
-        if len(crc_bytes) != 2:
+        calculated_crc = self.packet_checksum(read_data)
+        crc_bytes = self.ser.read(len(calculated_crc))
+        if len(crc_bytes) != len(calculated_crc):
             print("Error reading CRC")
             return False
         
-        received_crc = struct.unpack('<H', crc_bytes)[0]
-        calculated_crc = self.calculate_crc16(read_data)
-        
-        if received_crc != calculated_crc:
-            print(f"CRC mismatch: received 0x{received_crc:04X}, calculated 0x{calculated_crc:04X}")
+        if crc_bytes != calculated_crc:
+            print(f"CRC mismatch: received 0x{crc_bytes[::-1].hex().upper()}, "
+                  f"calculated 0x{calculated_crc[::-1].hex().upper()}")
             return False
         
         # Compare data
@@ -261,6 +734,20 @@ class W25Q64Flasher:
         
         return True
     
+    def flash_crc32(self, address, length):
+        """Ask the device for the CRC32 of a flash range, None if unsupported or failed"""
+        self.send_command(BOOT_CMD_VERIFY, struct.pack('<II', length, address))
+        
+        # The device reads the whole range before answering (~1 s per MB is generous)
+        old_timeout = self.ser.timeout
+        self.ser.timeout = TIMEOUT + length / (1024 * 1024)
+        response = self.ser.read(5)
+        self.ser.timeout = old_timeout
+        
+        if len(response) < 1 or response[0] != BOOT_ACK or len(response) != 5:
+            return None
+        return struct.unpack('<I', response[1:5])[0]
+    
     def verify_file(self, filename, start_address=0x00000000):
         """Verify file in flash"""
         # Read file
@@ -272,12 +759,26 @@ class W25Q64Flasher:
             return False
         
         file_size = len(file_data)
+        print(f"\nVerifying {file_size} bytes (device CRC32)... ", end='', flush=True)
+        device_crc = self.flash_crc32(start_address, file_size)
+        if device_crc is not None:
+            expected_crc = zlib.crc32(file_data)
+            if device_crc == expected_crc:
+                print(f"OK (0x{device_crc:08X})")
+                print("\nVerification complete!")
+                return True
+            print(f"FAILED (device 0x{device_crc:08X}, file 0x{expected_crc:08X})")
+            return False
+        
+        # Older firmware without BOOT_CMD_VERIFY: read everything back
+        print("not supported, reading back")
+        self.ser.reset_input_buffer()
         print(f"\nVerifying {file_size} bytes...")
-        total_chunks = (file_size + MAX_CHUNK_SIZE - 1) // MAX_CHUNK_SIZE
+        total_chunks = (file_size + self.chunk_size - 1) // self.chunk_size
         
         for chunk_num in range(total_chunks):
-            offset = chunk_num * MAX_CHUNK_SIZE
-            chunk_size = min(MAX_CHUNK_SIZE, file_size - offset)
+            offset = chunk_num * self.chunk_size
+            chunk_size = min(self.chunk_size, file_size - offset)
             chunk_data = file_data[offset:offset + chunk_size]
             chunk_address = start_address + offset
             
@@ -301,6 +802,20 @@ def main():
     parser.add_argument('-a', '--address', default='0x00000000', help='Start address (hex, default: 0x00000000)')
     parser.add_argument('-v', '--verify', action='store_true', help='Verify after writing')
     parser.add_argument('-i', '--info', action='store_true', help='Only get flash info')
+    parser.add_argument('-e', '--erase-chip', action='store_true', help='Only erase the whole chip')
+    parser.add_argument('--stats', action='store_true',
+                        help='Only print the firmware profiling histograms (PROF_ENABLED builds)')
+    parser.add_argument('--clear-stats', action='store_true', help='Reset the histograms after --stats')
+    parser.add_argument('-s', '--sync', action='store_true',
+                        help='Only erase and rewrite sectors that differ from the file')
+    parser.add_argument('-w', '--window', type=int, default=WINDOW_SIZE,
+                        help=f'Write packets in flight (default: {WINDOW_SIZE}, 0 = legacy stop-and-wait)')
+    parser.add_argument('-c', '--chunk-size', type=int, default=MAX_CHUNK_SIZE,
+                        help=f'Data bytes per write packet (default: {MAX_CHUNK_SIZE}, max: {MAX_CHUNK_SIZE})')
+    parser.add_argument('-k', '--integrity', choices=['crc16', 'crc32'], default='crc32',
+                        help='Packet checksum (default: crc32 on the device CRC unit, crc16 if unsupported)')
+    parser.add_argument('-m', '--max-baudrate', type=int, default=BAUD_CANDIDATES[0],
+                        help=f'Negotiate up to this baud rate (default: {BAUD_CANDIDATES[0]}, 0 = keep --baudrate)')
     
     args = parser.parse_args()
     
@@ -312,20 +827,39 @@ def main():
         sys.exit(1)
     
     # Check if file exists
-    if not args.info and not Path(args.file).is_file():
+    if not args.info and not args.erase_chip and not args.stats and not Path(args.file).is_file():
         print(f"File not found: {args.file}")
         sys.exit(1)
     
+    if not 1 <= args.chunk_size <= MAX_CHUNK_SIZE:
+        print(f"Invalid chunk size: {args.chunk_size} (1..{MAX_CHUNK_SIZE})")
+        sys.exit(1)
+    
     # Create flasher instance
-    flasher = W25Q64Flasher(args.port, args.baudrate)
+    flasher = W25Q64Flasher(args.port, args.baudrate, args.window, args.chunk_size)
     
     try:
+        if args.max_baudrate > args.baudrate:
+            flasher.negotiate_baudrate(args.max_baudrate)
+        
+        if args.integrity == 'crc32' and not flasher.set_integrity(INTEGRITY_CRC32):
+            print("CRC32 packets not supported, using CRC16")
+        
         if args.info:
             # Only get info
             flasher.get_info()
+        elif args.stats:
+            flasher.print_stats(args.clear_stats)
+        elif args.erase_chip:
+            if flasher.erase_chip():
+                print("\n✓ Chip erased!")
+            else:
+                print("\n✗ Chip erase failed!")
+                sys.exit(1)
         else:
-            # Write file
-            if flasher.write_file(args.file, start_address):
+            # Write file (or only its changed sectors)
+            upload = flasher.sync_file if args.sync else flasher.write_file
+            if upload(args.file, start_address):
                 print("\n✓ Upload successful!")
                 
                 # Verify if requested